@@ -0,0 +1,232 @@
+#include "allocation_profile.hpp"
+#include "container_memory.hpp"
+#include <algorithm>
+#include <limits>
+#include <sstream>
+
+SizeClassConfig::SizeClassConfig(std::vector<unsigned int> class_sizes) : class_sizes(std::move(class_sizes)) {
+    auto &sizes = this->class_sizes;
+    sizes.erase(std::remove(sizes.begin(), sizes.end(), 0u), sizes.end());
+    std::sort(sizes.begin(), sizes.end());
+    sizes.erase(std::unique(sizes.begin(), sizes.end()), sizes.end());
+}
+
+unsigned int SizeClassConfig::round_up(unsigned int length) const {
+    // an empty region reserves nothing, whatever the classes
+    if (length == 0) {
+        return 0;
+    }
+    auto size_class = std::lower_bound(class_sizes.begin(), class_sizes.end(), length);
+    return size_class == class_sizes.end() ? length : *size_class;
+}
+
+const std::vector<unsigned int> &SizeClassConfig::get_class_sizes() const { return class_sizes; }
+
+bool SizeClassConfig::empty() const { return class_sizes.empty(); }
+
+std::string SizeClassConfig::serialize() const {
+    std::ostringstream os;
+    os << "size_classes";
+    for (unsigned int size : class_sizes) {
+        os << " " << size;
+    }
+    return os.str();
+}
+
+std::optional<SizeClassConfig> SizeClassConfig::deserialize(const std::string &text) {
+    std::istringstream is(text);
+    std::string tag;
+    if (!(is >> tag) || tag != "size_classes") {
+        return std::nullopt;
+    }
+
+    std::vector<unsigned int> sizes;
+    unsigned int size;
+    while (is >> size) {
+        sizes.push_back(size);
+    }
+    if (!is.eof()) {
+        return std::nullopt;
+    }
+    return SizeClassConfig(std::move(sizes));
+}
+
+void AllocationProfile::record_search(unsigned int length) { search_lengths[length]++; }
+
+void AllocationProfile::record_placement(unsigned int length, unsigned int live_regions) {
+    placement_lengths[length]++;
+    peak_live_regions = std::max(peak_live_regions, live_regions);
+}
+
+const std::map<unsigned int, unsigned long long> &AllocationProfile::get_search_lengths() const {
+    return search_lengths;
+}
+
+const std::map<unsigned int, unsigned long long> &AllocationProfile::get_placement_lengths() const {
+    return placement_lengths;
+}
+
+unsigned int AllocationProfile::get_peak_live_regions() const { return peak_live_regions; }
+
+std::size_t AllocationProfile::memory_bytes() const {
+    return ordered_container_bytes(search_lengths) + ordered_container_bytes(placement_lengths);
+}
+
+SizeClassConfig AllocationProfile::compute_size_classes(unsigned int max_classes, unsigned int granule_size) const {
+    const auto &histogram = placement_lengths.empty() ? search_lengths : placement_lengths;
+    if (granule_size == 0) {
+        granule_size = 1;
+    }
+
+    // rounding to whole granules happens anyway, so only granule multiples are candidate classes
+    std::map<unsigned long long, double> counts_by_size;
+    double total_count = 0.0;
+    for (const auto &[length, count] : histogram) {
+        if (length == 0) {
+            continue;
+        }
+        unsigned long long rounded = (static_cast<unsigned long long>(length) + granule_size - 1) / granule_size;
+        counts_by_size[rounded * granule_size] += static_cast<double>(count);
+        total_count += static_cast<double>(count);
+    }
+
+    if (counts_by_size.empty() || max_classes == 0) {
+        return {};
+    }
+
+    // the search below is quadratic in the number of candidates, so very spread out profiles are first reduced to
+    // buckets of roughly equal weight, each one represented by its largest size
+    constexpr std::size_t max_candidates = 1024;
+    std::vector<double> sizes;
+    std::vector<double> counts;
+    double bucket_weight = total_count / max_candidates;
+    double pending_count = 0.0;
+    std::size_t remaining = counts_by_size.size();
+    for (const auto &[size, count] : counts_by_size) {
+        pending_count += count;
+        remaining--;
+        if (counts_by_size.size() <= max_candidates || pending_count >= bucket_weight || remaining == 0) {
+            sizes.push_back(static_cast<double>(size));
+            counts.push_back(pending_count);
+            pending_count = 0.0;
+        }
+    }
+
+    // the counts below each bucket are charged as if they were at the bucket's largest size, that's only the
+    // rounding inside the bucket which is left out of the waste
+    std::size_t m = sizes.size();
+    std::vector<double> count_prefix(m + 1, 0.0);
+    std::vector<double> weighted_prefix(m + 1, 0.0);
+    for (std::size_t i = 0; i < m; ++i) {
+        count_prefix[i + 1] = count_prefix[i] + counts[i];
+        weighted_prefix[i + 1] = weighted_prefix[i] + counts[i] * sizes[i];
+    }
+
+    // the rounding waste of serving candidates first..last with one class at sizes[last]
+    auto waste = [&](std::size_t first, std::size_t last) {
+        return sizes[last] * (count_prefix[last + 1] - count_prefix[first]) -
+               (weighted_prefix[last + 1] - weighted_prefix[first]);
+    };
+
+    // best[k][j] is the least waste covering candidates 0..j with k + 1 classes, the largest of them at sizes[j]
+    std::size_t class_limit = std::min<std::size_t>(max_classes, m);
+    constexpr double infinity = std::numeric_limits<double>::infinity();
+    std::vector<std::vector<double>> best(class_limit, std::vector<double>(m, infinity));
+    std::vector<std::vector<std::size_t>> previous(class_limit, std::vector<std::size_t>(m, 0));
+
+    for (std::size_t j = 0; j < m; ++j) {
+        best[0][j] = waste(0, j);
+    }
+    for (std::size_t k = 1; k < class_limit; ++k) {
+        for (std::size_t j = k; j < m; ++j) {
+            for (std::size_t i = k; i <= j; ++i) {
+                double cost = best[k - 1][i - 1] + waste(i, j);
+                if (cost < best[k][j]) {
+                    best[k][j] = cost;
+                    previous[k][j] = i - 1;
+                }
+            }
+        }
+    }
+
+    auto classes_for = [&](std::size_t k) {
+        std::vector<unsigned int> classes;
+        std::size_t j = m - 1;
+        for (std::size_t level = k + 1; level-- > 0;) {
+            classes.push_back(static_cast<unsigned int>(sizes[j]));
+            j = previous[level][j];
+        }
+        return classes;
+    };
+
+    // pick the class count where the waste per region at peak occupancy plus the stranded regions is smallest
+    double live_regions = std::max(1u, peak_live_regions);
+    std::size_t best_k = 0;
+    double best_cost = infinity;
+    for (std::size_t k = 0; k < class_limit; ++k) {
+        std::vector<unsigned int> classes = classes_for(k);
+        double stranded = 0.0;
+        for (unsigned int size : classes) {
+            stranded += size;
+        }
+        double cost = best[k][m - 1] / total_count * live_regions + stranded;
+        if (cost < best_cost) {
+            best_cost = cost;
+            best_k = k;
+        }
+    }
+
+    return SizeClassConfig(classes_for(best_k));
+}
+
+std::string AllocationProfile::serialize() const {
+    std::ostringstream os;
+    os << "allocation_profile 1\n";
+    os << "peak_live_regions " << peak_live_regions << "\n";
+    for (const auto &[length, count] : search_lengths) {
+        os << "search " << length << " " << count << "\n";
+    }
+    for (const auto &[length, count] : placement_lengths) {
+        os << "placement " << length << " " << count << "\n";
+    }
+    return os.str();
+}
+
+std::optional<AllocationProfile> AllocationProfile::deserialize(const std::string &text) {
+    std::istringstream is(text);
+    std::string tag;
+    int version = 0;
+    if (!(is >> tag >> version) || tag != "allocation_profile" || version != 1) {
+        return std::nullopt;
+    }
+
+    AllocationProfile profile;
+    while (is >> tag) {
+        if (tag == "peak_live_regions") {
+            if (!(is >> profile.peak_live_regions)) {
+                return std::nullopt;
+            }
+            continue;
+        }
+
+        unsigned int length;
+        unsigned long long count;
+        if (!(is >> length >> count)) {
+            return std::nullopt;
+        }
+        if (tag == "search") {
+            profile.search_lengths[length] += count;
+        } else if (tag == "placement") {
+            profile.placement_lengths[length] += count;
+        } else {
+            return std::nullopt;
+        }
+    }
+    return profile;
+}
+
+void AllocationProfile::clear() {
+    search_lengths.clear();
+    placement_lengths.clear();
+    peak_live_regions = 0;
+}
@@ -0,0 +1,113 @@
+#ifndef ALLOCATION_PROFILE_HPP
+#define ALLOCATION_PROFILE_HPP
+
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+/**
+ * @class SizeClassConfig
+ * @brief A sorted set of lengths that new regions are rounded up to when a tracker runs in segregated fit.
+ *
+ * Lengths above the largest class are left as they are. An empty config rounds nothing.
+ */
+class SizeClassConfig {
+  public:
+    SizeClassConfig() = default;
+
+    /**
+     * @brief Builds a config from class sizes in any order, duplicates and zeros are dropped.
+     */
+    explicit SizeClassConfig(std::vector<unsigned int> class_sizes);
+
+    /**
+     * @brief The smallest class that holds length, or length itself if no class is large enough or length is 0.
+     */
+    unsigned int round_up(unsigned int length) const;
+
+    const std::vector<unsigned int> &get_class_sizes() const;
+
+    bool empty() const;
+
+    /**
+     * @brief Writes the config as a single line of text, see deserialize.
+     */
+    std::string serialize() const;
+
+    /**
+     * @brief Reads a config written by serialize.
+     * @return The config, or std::nullopt if the text isn't a serialized config.
+     */
+    static std::optional<SizeClassConfig> deserialize(const std::string &text);
+
+  private:
+    /// ascending and unique.
+    std::vector<unsigned int> class_sizes;
+};
+
+/**
+ * @class AllocationProfile
+ * @brief Records the distribution of requested region lengths and derives size classes from it.
+ *
+ * Searches (find_contiguous_space) and placements (add_metadata) are kept in separate histograms since
+ * allocate goes through both. The profile can be serialized for offline analysis and read back later.
+ */
+class AllocationProfile {
+  public:
+    void record_search(unsigned int length);
+
+    /**
+     * @brief Records a placed region.
+     * @param length The length of the region.
+     * @param live_regions The number of regions alive after the placement, used to track the peak.
+     */
+    void record_placement(unsigned int length, unsigned int live_regions);
+
+    /// maps each length passed to find_contiguous_space to how often it was requested.
+    const std::map<unsigned int, unsigned long long> &get_search_lengths() const;
+
+    /// maps each length passed to add_metadata to how often it was placed.
+    const std::map<unsigned int, unsigned long long> &get_placement_lengths() const;
+
+    /// the largest number of regions that were alive at the same time.
+    unsigned int get_peak_live_regions() const;
+
+    /// the heap bytes held by both histograms.
+    std::size_t memory_bytes() const;
+
+    /**
+     * @brief Chooses the size classes that minimize the expected wasted space for this profile.
+     *
+     * Rounding a length up to its class wastes the difference for as long as the region lives, which is charged
+     * once per region at the peak number of live regions. Every class also strands about one free region of its
+     * size on its free list, which is what segregated fit gives up in fragmentation. The number of classes and
+     * their sizes are chosen to minimize the sum of both, using the placement histogram if there is one and the
+     * search histogram otherwise.
+     *
+     * @param max_classes The most classes the result may have.
+     * @param granule_size The granule size of the tracker the config is meant for, every class is a multiple of it.
+     * @return The chosen classes, empty if nothing was recorded.
+     */
+    SizeClassConfig compute_size_classes(unsigned int max_classes, unsigned int granule_size = 1) const;
+
+    /**
+     * @brief Writes the profile as text with one histogram bucket per line, see deserialize.
+     */
+    std::string serialize() const;
+
+    /**
+     * @brief Reads a profile written by serialize.
+     * @return The profile, or std::nullopt if the text isn't a serialized profile.
+     */
+    static std::optional<AllocationProfile> deserialize(const std::string &text);
+
+    void clear();
+
+  private:
+    std::map<unsigned int, unsigned long long> search_lengths;
+    std::map<unsigned int, unsigned long long> placement_lengths;
+    unsigned int peak_live_regions = 0;
+};
+
+#endif // ALLOCATION_PROFILE_HPP
@@ -0,0 +1,181 @@
+#include "bulk_placement_validator.hpp"
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <iterator>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+/// sets bit k of mask for every k below n with a[k] > b[k].
+void mark_greater(const unsigned int *a, const unsigned int *b, std::size_t n, std::uint64_t *mask) {
+    std::size_t k = 0;
+
+    // there is no unsigned compare before AVX-512, flipping the sign bit turns it into a signed one
+#if defined(__AVX2__)
+    const __m256i bias = _mm256_set1_epi32(INT_MIN);
+    for (; k + 8 <= n; k += 8) {
+        __m256i left = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + k)), bias);
+        __m256i right = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + k)), bias);
+        auto bits = static_cast<unsigned int>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(left, right))));
+        mask[k / 64] |= std::uint64_t(bits) << (k % 64);
+    }
+#elif defined(__SSE2__)
+    const __m128i bias = _mm_set1_epi32(INT_MIN);
+    for (; k + 4 <= n; k += 4) {
+        __m128i left = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a + k)), bias);
+        __m128i right = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(b + k)), bias);
+        auto bits = static_cast<unsigned int>(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(left, right))));
+        mask[k / 64] |= std::uint64_t(bits) << (k % 64);
+    }
+#endif
+
+    for (; k < n; ++k) {
+        if (a[k] > b[k]) {
+            mask[k / 64] |= std::uint64_t(1) << (k % 64);
+        }
+    }
+}
+} // namespace
+
+void BulkPlacementValidator::load(const unsigned int *starts, const unsigned int *ends, std::size_t count) {
+    this->count = count;
+
+    std::vector<unsigned int> keys(starts, starts + count);
+    std::vector<unsigned int> values(ends, ends + count);
+    std::vector<unsigned int> indices(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        indices[i] = static_cast<unsigned int>(i);
+    }
+
+    // bytes every start agrees on don't change the order, placements tend to share their high bytes
+    unsigned int differing = 0;
+    for (std::size_t i = 1; i < count; ++i) {
+        differing |= keys[i] ^ keys[0];
+    }
+
+    std::vector<unsigned int> next_keys(count);
+    std::vector<unsigned int> next_values(count);
+    std::vector<unsigned int> next_indices(count);
+    for (unsigned int shift = 0; shift < 32; shift += 8) {
+        if (((differing >> shift) & 0xff) == 0) {
+            continue;
+        }
+
+        std::array<std::size_t, 256> offsets{};
+        for (std::size_t i = 0; i < count; ++i) {
+            offsets[(keys[i] >> shift) & 0xff]++;
+        }
+        std::size_t total = 0;
+        for (auto &offset : offsets) {
+            std::size_t bucket = offset;
+            offset = total;
+            total += bucket;
+        }
+
+        for (std::size_t i = 0; i < count; ++i) {
+            std::size_t target = offsets[(keys[i] >> shift) & 0xff]++;
+            next_keys[target] = keys[i];
+            next_values[target] = values[i];
+            next_indices[target] = indices[i];
+        }
+        keys.swap(next_keys);
+        values.swap(next_values);
+        indices.swap(next_indices);
+    }
+
+    sorted_starts.clear();
+    sorted_ends.clear();
+    sorted_indices.clear();
+    empty_starts.clear();
+    empty_indices.clear();
+    for (std::size_t i = 0; i < count; ++i) {
+        if (values[i] == keys[i]) {
+            empty_starts.push_back(keys[i]);
+            empty_indices.push_back(indices[i]);
+        } else {
+            sorted_starts.push_back(keys[i]);
+            sorted_ends.push_back(values[i]);
+            sorted_indices.push_back(indices[i]);
+        }
+    }
+}
+
+std::size_t BulkPlacementValidator::mask_words() const { return (count + 63) / 64; }
+
+void BulkPlacementValidator::scatter(const std::vector<std::uint64_t> &sorted_mask,
+                                     std::vector<std::uint64_t> &rejected) const {
+    for (std::size_t word = 0; word < sorted_mask.size(); ++word) {
+        for (std::uint64_t bits = sorted_mask[word]; bits != 0; bits &= bits - 1) {
+            std::size_t bit = 0;
+            while (((bits >> bit) & 1) == 0) {
+                bit++;
+            }
+            unsigned int index = sorted_indices[word * 64 + bit];
+            rejected[index / 64] |= std::uint64_t(1) << (index % 64);
+        }
+    }
+}
+
+void BulkPlacementValidator::reject_overlaps(std::vector<std::uint64_t> &rejected) const {
+    std::size_t n = sorted_starts.size();
+    std::vector<std::uint64_t> sorted_mask((n + 63) / 64, 0);
+
+    // sorted by start, an interval overlaps an earlier one iff the largest end so far passes its start, and a later
+    // one iff its end passes the next start
+    std::vector<unsigned int> largest_end_before(n);
+    unsigned int largest_end = 0;
+    for (std::size_t k = 0; k < n; ++k) {
+        largest_end_before[k] = largest_end;
+        largest_end = std::max(largest_end, sorted_ends[k]);
+    }
+    mark_greater(largest_end_before.data(), sorted_starts.data(), n, sorted_mask.data());
+    if (n > 1) {
+        mark_greater(sorted_ends.data(), sorted_starts.data() + 1, n - 1, sorted_mask.data());
+    }
+    scatter(sorted_mask, rejected);
+
+    // an empty interval is only hit by a non-empty one starting strictly before it and ending strictly after it
+    std::size_t next = 0;
+    largest_end = 0;
+    for (std::size_t e = 0; e < empty_starts.size(); ++e) {
+        while (next < n && sorted_starts[next] < empty_starts[e]) {
+            largest_end = std::max(largest_end, sorted_ends[next++]);
+        }
+        if (largest_end > empty_starts[e]) {
+            rejected[empty_indices[e] / 64] |= std::uint64_t(1) << (empty_indices[e] % 64);
+        }
+    }
+}
+
+void BulkPlacementValidator::reject_outside(const std::map<unsigned int, unsigned int> &gaps,
+                                            std::vector<std::uint64_t> &rejected) const {
+    std::size_t n = sorted_starts.size();
+    std::vector<std::uint64_t> sorted_mask((n + 63) / 64, 0);
+
+    // merge the sorted starts with the gaps to find the end of the last gap starting at or before each of them, an
+    // interval fits iff it ends by then
+    std::vector<unsigned int> gap_end(n, 0);
+    auto next_gap = gaps.begin();
+    unsigned int current_end = 0;
+    for (std::size_t k = 0; k < n; ++k) {
+        if (next_gap != gaps.end() && next_gap->first <= sorted_starts[k]) {
+            // step once, a sparse batch over many gaps jumps instead of walking all of them
+            current_end = next_gap->second;
+            ++next_gap;
+            if (next_gap != gaps.end() && next_gap->first <= sorted_starts[k]) {
+                next_gap = gaps.upper_bound(sorted_starts[k]);
+                current_end = std::prev(next_gap)->second;
+            }
+        }
+        gap_end[k] = current_end;
+    }
+    mark_greater(sorted_ends.data(), gap_end.data(), n, sorted_mask.data());
+    scatter(sorted_mask, rejected);
+}
+
+const std::vector<unsigned int> &BulkPlacementValidator::get_empty_indices() const { return empty_indices; }
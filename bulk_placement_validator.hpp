@@ -0,0 +1,61 @@
+#ifndef BULK_PLACEMENT_VALIDATOR_HPP
+#define BULK_PLACEMENT_VALIDATOR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+/**
+ * @class BulkPlacementValidator
+ * @brief Checks a large batch of intervals against each other and against a set of free gaps in a few linear passes.
+ *
+ * The batch is given as separate arrays of starts and ends and sorted by start with an LSD radix sort, one pass per
+ * byte that actually differs between the starts. Once sorted, a non-empty interval overlaps another one exactly when
+ * the largest end before it or the next start after it crosses it, and it fits the free space exactly when it ends
+ * before the gap its start falls in. All three become element-wise comparisons of plain arrays, done 8 or 4 at a time
+ * with AVX2 or SSE2 where the compiler targets them and one at a time otherwise.
+ *
+ * Results are bitmasks with one bit per interval in input order, bit i % 64 of word i / 64.
+ */
+class BulkPlacementValidator {
+  public:
+    /**
+     * @brief Loads and sorts a batch, interval i is [starts[i], ends[i]) and empty if both are equal.
+     */
+    void load(const unsigned int *starts, const unsigned int *ends, std::size_t count);
+
+    /// the number of 64 bit words a bitmask over the loaded batch needs.
+    std::size_t mask_words() const;
+
+    /**
+     * @brief Sets the bit of every non-empty interval that overlaps another one and of every empty interval that sits
+     * strictly inside a non-empty one, the conditions add_metadata puts on regions among themselves.
+     */
+    void reject_overlaps(std::vector<std::uint64_t> &rejected) const;
+
+    /**
+     * @brief Sets the bit of every non-empty interval that doesn't lie inside a single gap.
+     * @param gaps Disjoint gaps keyed by start with their end as value.
+     */
+    void reject_outside(const std::map<unsigned int, unsigned int> &gaps, std::vector<std::uint64_t> &rejected) const;
+
+    /// the input indices of the empty intervals, by ascending start.
+    const std::vector<unsigned int> &get_empty_indices() const;
+
+  private:
+    std::size_t count = 0;
+
+    /// the non-empty intervals sorted by start, as parallel arrays.
+    std::vector<unsigned int> sorted_starts;
+    std::vector<unsigned int> sorted_ends;
+    std::vector<unsigned int> sorted_indices;
+
+    std::vector<unsigned int> empty_starts;
+    std::vector<unsigned int> empty_indices;
+
+    /// sets the input order bit of every sorted position whose bit is set in sorted_mask.
+    void scatter(const std::vector<std::uint64_t> &sorted_mask, std::vector<std::uint64_t> &rejected) const;
+};
+
+#endif // BULK_PLACEMENT_VALIDATOR_HPP
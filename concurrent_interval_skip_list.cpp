@@ -0,0 +1,393 @@
+#include "concurrent_interval_skip_list.hpp"
+#include <algorithm>
+#include <functional>
+#include <thread>
+
+ConcurrentIntervalSkipList::Node::Node(unsigned int start, unsigned int end, int id, int height)
+    : start(start), end(end), id(id), height(height), next(new std::atomic<Node *>[height]),
+      gap_hint(new std::atomic<unsigned int>[height]) {
+    for (int level = 0; level < height; ++level) {
+        next[level].store(nullptr, std::memory_order_relaxed);
+        gap_hint[level].store(0, std::memory_order_relaxed);
+    }
+}
+
+ConcurrentIntervalSkipList::ConcurrentIntervalSkipList(unsigned int capacity)
+    : capacity(capacity), head(make_head()) {}
+
+ConcurrentIntervalSkipList::ConcurrentIntervalSkipList(const ConcurrentIntervalSkipList &other)
+    : ConcurrentIntervalSkipList(other.capacity) {
+    copy_from(other);
+}
+
+ConcurrentIntervalSkipList &ConcurrentIntervalSkipList::operator=(const ConcurrentIntervalSkipList &other) {
+    if (this != &other) {
+        capacity = other.capacity;
+        copy_from(other);
+    }
+    return *this;
+}
+
+void ConcurrentIntervalSkipList::copy_from(const ConcurrentIntervalSkipList &other) {
+    std::vector<Entry> entries;
+    for (const Node *node = other.head.load(std::memory_order_acquire)->next[0].load(std::memory_order_acquire); node;
+         node = node->next[0].load(std::memory_order_acquire)) {
+        entries.push_back({node->start, node->end, node->id});
+    }
+    assign_sorted(entries);
+}
+
+ConcurrentIntervalSkipList::~ConcurrentIntervalSkipList() { delete_chain(head.load(std::memory_order_relaxed)); }
+
+ConcurrentIntervalSkipList::Node *ConcurrentIntervalSkipList::make_head() const {
+    Node *node = new Node(0, 0, -1, max_levels);
+    for (int level = 0; level < max_levels; ++level) {
+        node->gap_hint[level].store(capacity, std::memory_order_relaxed);
+    }
+    node->fully_linked.store(true, std::memory_order_relaxed);
+    return node;
+}
+
+void ConcurrentIntervalSkipList::delete_chain(void *first) {
+    Node *node = static_cast<Node *>(first);
+    while (node) {
+        Node *next = node->next[0].load(std::memory_order_relaxed);
+        delete node;
+        node = next;
+    }
+}
+
+std::size_t ConcurrentIntervalSkipList::node_bytes(int height) {
+    return sizeof(Node) + height * (sizeof(std::atomic<Node *>) + sizeof(std::atomic<unsigned int>));
+}
+
+int ConcurrentIntervalSkipList::random_height() {
+    thread_local std::uint64_t state = std::hash<std::thread::id>{}(std::this_thread::get_id()) | 1;
+
+    // xorshift64, every level above the first is kept with probability 1/4
+    int height = 1;
+    for (;;) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        if (height == max_levels || (state & 3) != 0) {
+            return height;
+        }
+        height++;
+    }
+}
+
+void ConcurrentIntervalSkipList::locate(unsigned int start, Path &preds, Path &succs) const {
+    Node *pred = head.load(std::memory_order_acquire);
+    for (int level = max_levels - 1; level >= 0; --level) {
+        Node *curr = pred->next[level].load(std::memory_order_acquire);
+        while (curr && curr->start < start) {
+            pred = curr;
+            curr = pred->next[level].load(std::memory_order_acquire);
+        }
+        preds[level] = pred;
+        succs[level] = curr;
+    }
+}
+
+unsigned int ConcurrentIntervalSkipList::next_start(const Node *node) const {
+    const Node *next = node->next[0].load(std::memory_order_acquire);
+    return next ? next->start : capacity;
+}
+
+int ConcurrentIntervalSkipList::lock_path(const Path &preds, int levels, Path &locked) {
+    // preds never increase in start from one level to the next, so repeats are adjacent and every thread locks
+    // nodes in descending start order, which rules out deadlocks
+    int count = 0;
+    for (int level = 0; level < levels; ++level) {
+        if (count == 0 || locked[count - 1] != preds[level]) {
+            preds[level]->lock.lock();
+            locked[count++] = preds[level];
+        }
+    }
+    return count;
+}
+
+void ConcurrentIntervalSkipList::unlock_path(Path &locked, int count) {
+    for (int i = 0; i < count; ++i) {
+        locked[i]->lock.unlock();
+    }
+}
+
+void ConcurrentIntervalSkipList::raise_hint(std::atomic<unsigned int> &hint, unsigned int value) {
+    if (hint.load(std::memory_order_relaxed) < value) {
+        hint.store(value, std::memory_order_relaxed);
+    }
+}
+
+bool ConcurrentIntervalSkipList::insert(unsigned int start, unsigned int end, int id) {
+    if (start >= end || end > capacity) {
+        return false;
+    }
+
+    int height = random_height();
+    int top = top_level.load(std::memory_order_relaxed);
+    while (top < height && !top_level.compare_exchange_weak(top, height)) {
+    }
+
+    auto guard = reclaimer.pin();
+    for (;;) {
+        Path preds;
+        Path succs;
+        locate(start, preds, succs);
+
+        Path locked;
+        int count = lock_path(preds, height, locked);
+
+        // nothing may have been linked in between or be on its way out since locate ran
+        bool valid = true;
+        for (int level = 0; level < height && valid; ++level) {
+            valid = !preds[level]->marked.load(std::memory_order_acquire) &&
+                    preds[level]->next[level].load(std::memory_order_acquire) == succs[level] &&
+                    (!succs[level] || !succs[level]->marked.load(std::memory_order_acquire));
+        }
+        if (!valid) {
+            unlock_path(locked, count);
+            continue;
+        }
+
+        // with both neighbours on level 0 locked in place, checking them is enough to rule out any overlap
+        if (preds[0]->end > start || (succs[0] && succs[0]->start < end)) {
+            unlock_path(locked, count);
+            return false;
+        }
+
+        // the new node splits each span it's linked into, both halves keep the old hint as an overestimate
+        Node *node = new Node(start, end, id, height);
+        for (int level = 0; level < height; ++level) {
+            node->next[level].store(succs[level], std::memory_order_relaxed);
+            if (level > 0) {
+                node->gap_hint[level].store(preds[level]->gap_hint[level].load(std::memory_order_relaxed),
+                                            std::memory_order_relaxed);
+            }
+        }
+        for (int level = 0; level < height; ++level) {
+            preds[level]->next[level].store(node, std::memory_order_release);
+        }
+        node->fully_linked.store(true, std::memory_order_release);
+
+        unlock_path(locked, count);
+        return true;
+    }
+}
+
+std::optional<int> ConcurrentIntervalSkipList::remove(unsigned int start) {
+    auto guard = reclaimer.pin();
+    Node *victim = nullptr;
+
+    for (;;) {
+        Path preds;
+        Path succs;
+        locate(start, preds, succs);
+
+        // marking the node under its own lock is what removes it, everything after only catches the links up
+        if (!victim) {
+            Node *candidate = succs[0];
+            if (!candidate || candidate->start != start || candidate->marked.load(std::memory_order_acquire)) {
+                return std::nullopt;
+            }
+            if (!candidate->fully_linked.load(std::memory_order_acquire)) {
+                continue;
+            }
+
+            candidate->lock.lock();
+            if (candidate->marked.load(std::memory_order_relaxed)) {
+                candidate->lock.unlock();
+                return std::nullopt;
+            }
+            candidate->marked.store(true, std::memory_order_release);
+            victim = candidate;
+        }
+
+        // every span containing the victim grows, so its owner is locked on every level in use, not only on the
+        // levels the victim is linked into
+        int levels = std::max(victim->height, top_level.load(std::memory_order_acquire));
+        Path locked;
+        int count = lock_path(preds, levels, locked);
+
+        bool valid = true;
+        for (int level = 0; level < levels && valid; ++level) {
+            Node *expected = level < victim->height ? victim : succs[level];
+            valid = !preds[level]->marked.load(std::memory_order_acquire) &&
+                    preds[level]->next[level].load(std::memory_order_acquire) == expected;
+        }
+        if (!valid) {
+            unlock_path(locked, count);
+            continue;
+        }
+
+        unsigned int merged_gap = next_start(victim) - preds[0]->end;
+        for (int level = victim->height - 1; level >= 0; --level) {
+            preds[level]->next[level].store(victim->next[level].load(std::memory_order_relaxed),
+                                            std::memory_order_release);
+        }
+        for (int level = 1; level < levels; ++level) {
+            unsigned int hint = merged_gap;
+            if (level < victim->height) {
+                hint = std::max(hint, victim->gap_hint[level].load(std::memory_order_relaxed));
+            }
+            raise_hint(preds[level]->gap_hint[level], hint);
+        }
+
+        unlock_path(locked, count);
+        victim->lock.unlock();
+
+        // no node links to the victim anymore, so only readers that are already pinned can still reach it
+        int id = victim->id;
+        reclaimer.retire(victim, node_bytes(victim->height));
+        return id;
+    }
+}
+
+std::optional<std::pair<unsigned int, int>> ConcurrentIntervalSkipList::find(unsigned int start) const {
+    auto guard = reclaimer.pin();
+    Path preds;
+    Path succs;
+    locate(start, preds, succs);
+
+    const Node *node = succs[0];
+    if (!node || node->start != start || node->marked.load(std::memory_order_acquire)) {
+        return std::nullopt;
+    }
+    return std::make_pair(node->end, node->id);
+}
+
+std::optional<unsigned int> ConcurrentIntervalSkipList::search(const Node *node, int level, const Node *limit,
+                                                               unsigned int length) const {
+    for (const Node *current = node; current && current != limit;) {
+        // a limit that was unlinked meanwhile is never reached, its start still bounds the span
+        if (limit && current != node && current->start >= limit->start) {
+            break;
+        }
+
+        const Node *next = current->next[level].load(std::memory_order_acquire);
+        if (level == 0) {
+            unsigned int gap_end = next ? next->start : capacity;
+            if (gap_end >= current->end && gap_end - current->end >= length) {
+                return current->end;
+            }
+        } else if (current->gap_hint[level].load(std::memory_order_relaxed) >= length) {
+            // the hint may overestimate, in which case the search carries on with the next span
+            auto found = search(current, level - 1, next, length);
+            if (found) {
+                return found;
+            }
+            tighten_span(current, level);
+        }
+        current = next;
+    }
+    return std::nullopt;
+}
+
+void ConcurrentIntervalSkipList::tighten_span(const Node *node, int level) const {
+    std::unique_lock<std::mutex> lock(node->lock, std::try_to_lock);
+    if (!lock.owns_lock() || node->marked.load(std::memory_order_acquire)) {
+        return;
+    }
+
+    // with the owner locked no gap in its span can grow and its end can't move, concurrent inserts only shrink gaps
+    // so whatever is read below stays an overestimate
+    const Node *limit = node->next[level].load(std::memory_order_acquire);
+    unsigned int largest = 0;
+    for (const Node *below = node; below && below != limit;
+         below = below->next[level - 1].load(std::memory_order_acquire)) {
+        unsigned int gap = level == 1 ? next_start(below) - below->end
+                                      : below->gap_hint[level - 1].load(std::memory_order_relaxed);
+        largest = std::max(largest, gap);
+    }
+    node->gap_hint[level].store(largest, std::memory_order_relaxed);
+}
+
+std::optional<unsigned int> ConcurrentIntervalSkipList::find_free(unsigned int length) const {
+    if (length == 0 || length > capacity) {
+        return std::nullopt;
+    }
+
+    auto guard = reclaimer.pin();
+    return search(head.load(std::memory_order_acquire), top_level.load(std::memory_order_acquire) - 1, nullptr, length);
+}
+
+std::optional<unsigned int> ConcurrentIntervalSkipList::allocate(unsigned int length, int id) {
+    for (;;) {
+        auto start = find_free(length);
+        if (!start) {
+            return std::nullopt;
+        }
+        if (insert(*start, *start + length, id)) {
+            return start;
+        }
+    }
+}
+
+void ConcurrentIntervalSkipList::tighten_gap_hints() {
+    tighten_hints(head.load(std::memory_order_relaxed), top_level.load(std::memory_order_relaxed));
+}
+
+void ConcurrentIntervalSkipList::tighten_hints(Node *first, int top) const {
+    // every span on a level is the union of the spans below it, so exact hints are built bottom up
+    for (int level = 1; level < top; ++level) {
+        for (Node *node = first; node; node = node->next[level].load(std::memory_order_relaxed)) {
+            Node *limit = node->next[level].load(std::memory_order_relaxed);
+            unsigned int largest = 0;
+            for (Node *below = node; below != limit; below = below->next[level - 1].load(std::memory_order_relaxed)) {
+                unsigned int gap = level == 1 ? next_start(below) - below->end
+                                              : below->gap_hint[level - 1].load(std::memory_order_relaxed);
+                largest = std::max(largest, gap);
+            }
+            node->gap_hint[level].store(largest, std::memory_order_relaxed);
+        }
+    }
+
+    // levels nobody is linked into yet keep the capacity, a node that's first to reach them inherits it
+    for (int level = std::max(top, 1); level < max_levels; ++level) {
+        first->gap_hint[level].store(capacity, std::memory_order_relaxed);
+    }
+}
+
+void ConcurrentIntervalSkipList::assign_sorted(const std::vector<Entry> &entries) {
+    // the new list is linked and hinted while nobody else can see it
+    Node *first = make_head();
+    Path last;
+    last.fill(first);
+    int top = 1;
+    for (const auto &entry : entries) {
+        int height = random_height();
+        top = std::max(top, height);
+        Node *node = new Node(entry.start, entry.end, entry.id, height);
+        for (int level = 0; level < height; ++level) {
+            last[level]->next[level].store(node, std::memory_order_relaxed);
+            last[level] = node;
+        }
+        node->fully_linked.store(true, std::memory_order_relaxed);
+    }
+    tighten_hints(first, top);
+
+    // top_level never shrinks, searches from above the new list's top only pass through the head's full hints
+    int current = top_level.load(std::memory_order_relaxed);
+    while (current < top && !top_level.compare_exchange_weak(current, top)) {
+    }
+
+    // searches that started on the old list keep it alive until they unpin
+    Node *old = head.exchange(first, std::memory_order_acq_rel);
+    std::size_t bytes = 0;
+    for (const Node *node = old; node; node = node->next[0].load(std::memory_order_relaxed)) {
+        bytes += node_bytes(node->height);
+    }
+    reclaimer.retire(old, &delete_chain, bytes);
+}
+
+void ConcurrentIntervalSkipList::clear() { assign_sorted({}); }
+
+std::size_t ConcurrentIntervalSkipList::memory_bytes() const {
+    std::size_t bytes = 0;
+    for (const Node *node = head.load(std::memory_order_acquire); node;
+         node = node->next[0].load(std::memory_order_acquire)) {
+        bytes += node_bytes(node->height);
+    }
+    return bytes + reclaimer.get_pending_bytes();
+}
@@ -0,0 +1,171 @@
+#ifndef CONCURRENT_INTERVAL_SKIP_LIST_HPP
+#define CONCURRENT_INTERVAL_SKIP_LIST_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "epoch_reclaimer.hpp"
+
+/**
+ * @class ConcurrentIntervalSkipList
+ * @brief A set of non-overlapping intervals inside [0, capacity) that many threads can modify and search at once.
+ *
+ * Intervals are kept in a skip list ordered by start. Searches never wait on a lock, they traverse the list under
+ * a pinned epoch, so nodes removed meanwhile stay valid until they're done. Inserting and removing lock only the
+ * nodes whose links change, which are the neighbours of the interval on each level, so writers in different parts
+ * of the array don't wait on each other and there's no lock over the whole list.
+ *
+ * Every node above level 0 carries a hint for the largest free gap between its own end and the start of its
+ * successor on that level, which lets find_free skip whole spans that can't hold a request. Hints are kept as
+ * overestimates: an insert copies the hint of the span it splits instead of recomputing both halves, a remove
+ * raises the hints of every span that now contains the merged gap. A search that finds a span's hint too high
+ * lowers it if the span's owner can be locked without waiting, and tighten_gap_hints recomputes all of them while
+ * no other thread uses the list.
+ *
+ * assign_sorted replaces the whole list in one step, searches running meanwhile see either the old or the new one.
+ *
+ * Units are whatever the caller uses, elements or granules.
+ */
+class ConcurrentIntervalSkipList {
+  public:
+    struct Entry {
+        unsigned int start;
+        unsigned int end;
+        int id;
+    };
+
+    explicit ConcurrentIntervalSkipList(unsigned int capacity);
+
+    /// copies the intervals of other with exact hints, must not run concurrently with any call on either list.
+    ConcurrentIntervalSkipList(const ConcurrentIntervalSkipList &other);
+    ConcurrentIntervalSkipList &operator=(const ConcurrentIntervalSkipList &other);
+
+    /// must not run concurrently with any other call.
+    ~ConcurrentIntervalSkipList();
+
+    /**
+     * @brief Adds [start, end) owned by id.
+     * @return False if the interval is empty, exceeds the capacity or overlaps an existing interval.
+     */
+    bool insert(unsigned int start, unsigned int end, int id);
+
+    /**
+     * @brief Removes the interval starting at start.
+     * @return The id that owned it, or std::nullopt if no interval starts there.
+     */
+    std::optional<int> remove(unsigned int start);
+
+    /**
+     * @brief Looks up the interval starting at start.
+     * @return {end, id}, or std::nullopt if no interval starts there.
+     */
+    std::optional<std::pair<unsigned int, int>> find(unsigned int start) const;
+
+    /**
+     * @brief The lowest start of a free gap of at least length, the gap may be taken by another thread right after.
+     */
+    std::optional<unsigned int> find_free(unsigned int length) const;
+
+    /**
+     * @brief Finds a free gap of length and inserts [start, start + length) owned by id there in one step, retrying
+     * when another thread takes the gap first.
+     * @return The start of the new interval, or std::nullopt if no gap is large enough.
+     */
+    std::optional<unsigned int> allocate(unsigned int length, int id);
+
+    /**
+     * @brief Recomputes every gap hint exactly. Must not run concurrently with any other call.
+     */
+    void tighten_gap_hints();
+
+    /**
+     * @brief Replaces the contents with entries sorted by start, which must not overlap, with exact gap hints.
+     *
+     * The new list is built aside and published at once, the old one is freed once no search uses it anymore.
+     * Searches and lookups may run concurrently, inserts and removes must not.
+     */
+    void assign_sorted(const std::vector<Entry> &entries);
+
+    /// assign_sorted with no entries.
+    void clear();
+
+    /// the heap bytes of the linked nodes and of the removed ones still waiting to be freed, walks every node.
+    std::size_t memory_bytes() const;
+
+  private:
+    static constexpr int max_levels = 16;
+
+    struct Node {
+        Node(unsigned int start, unsigned int end, int id, int height);
+
+        const unsigned int start;
+        const unsigned int end;
+        const int id;
+        const int height;
+
+        /// next[l] and gap_hint[l] exist for l < height, gap_hint[0] is unused since level 0 gaps are exact.
+        std::unique_ptr<std::atomic<Node *>[]> next;
+        std::unique_ptr<std::atomic<unsigned int>[]> gap_hint;
+
+        /// set once the node is linked on every level, removal waits for it.
+        std::atomic<bool> fully_linked{false};
+        /// set when the node is logically removed, before it's unlinked.
+        std::atomic<bool> marked{false};
+        mutable std::mutex lock;
+    };
+
+    using Path = std::array<Node *, max_levels>;
+
+    unsigned int capacity;
+
+    /// a sentinel [0, 0) of full height, its hints start at capacity on every level. Replaced by assign_sorted.
+    std::atomic<Node *> head;
+
+    /// the height of the tallest node ever inserted, levels above it only hold the head.
+    std::atomic<int> top_level{1};
+
+    mutable EpochReclaimer reclaimer;
+
+    static int random_height();
+
+    /// the bytes allocated for a node of height.
+    static std::size_t node_bytes(int height);
+
+    /// replaces the intervals of this list with the ones of other.
+    void copy_from(const ConcurrentIntervalSkipList &other);
+
+    /// a new sentinel for a list of capacity.
+    Node *make_head() const;
+
+    /// deletes first and every node after it on level 0, the deleter of retired lists.
+    static void delete_chain(void *first);
+
+    /// recomputes the hints of the list starting at first, whose nodes are at most top high.
+    void tighten_hints(Node *first, int top) const;
+
+    /// fills the last node before start and the one after it on every level, without locking.
+    void locate(unsigned int start, Path &preds, Path &succs) const;
+
+    /// the start of the node after node on level 0, or capacity at the end of the list.
+    unsigned int next_start(const Node *node) const;
+
+    /// the first fit search below node on level, up to but excluding the node limit.
+    std::optional<unsigned int> search(const Node *node, int level, const Node *limit, unsigned int length) const;
+
+    /// recomputes the hint of node on level from the level below, skipped if node is locked by someone else.
+    void tighten_span(const Node *node, int level) const;
+
+    /// locks the distinct nodes of preds[0, levels), returns them in locking order.
+    static int lock_path(const Path &preds, int levels, Path &locked);
+    static void unlock_path(Path &locked, int count);
+
+    static void raise_hint(std::atomic<unsigned int> &hint, unsigned int value);
+};
+
+#endif // CONCURRENT_INTERVAL_SKIP_LIST_HPP
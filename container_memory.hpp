@@ -0,0 +1,70 @@
+#ifndef CONTAINER_MEMORY_HPP
+#define CONTAINER_MEMORY_HPP
+
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief The heap bytes held by standard containers, for the memory_bytes of the classes built on them.
+ *
+ * Node based containers allocate one node per element, laid out here as libstdc++ lays them out, padding included:
+ * a node of an ordered container holds the color and three pointers before the value, a node of a hashed container
+ * the pointer to the next node before the value and, for hash functions libstdc++ doesn't consider cheap, the
+ * cached hash after it. Every node is rounded up to alignof(std::max_align_t), the granularity operator new hands
+ * out. The buckets of a hashed container are an array of pointers, except for a single bucket, which is stored in
+ * the container itself. The allocator's own bookkeeping per allocation is not included.
+ *
+ * All of them are O(1).
+ */
+namespace container_memory {
+template <typename Value> struct OrderedNode {
+    int color;
+    void *parent;
+    void *left;
+    void *right;
+    alignas(Value) unsigned char value[sizeof(Value)];
+};
+
+template <typename Value> struct HashedNode {
+    void *next;
+    alignas(Value) unsigned char value[sizeof(Value)];
+};
+
+template <typename Value> struct CachedHashedNode {
+    void *next;
+    alignas(Value) unsigned char value[sizeof(Value)];
+    std::size_t hash;
+};
+
+template <typename Container> constexpr bool caches_hash() {
+#if defined(__GLIBCXX__)
+    return std::__cache_default<typename Container::key_type, typename Container::hasher>::value;
+#else
+    return false;
+#endif
+}
+
+constexpr std::size_t allocated_bytes(std::size_t bytes) {
+    return (bytes + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+}
+} // namespace container_memory
+
+template <typename Container> std::size_t ordered_container_bytes(const Container &container) {
+    using Node = container_memory::OrderedNode<typename Container::value_type>;
+    return container.size() * container_memory::allocated_bytes(sizeof(Node));
+}
+
+template <typename Container> std::size_t hashed_container_bytes(const Container &container) {
+    using Value = typename Container::value_type;
+    constexpr std::size_t node_bytes = container_memory::caches_hash<Container>()
+                                           ? sizeof(container_memory::CachedHashedNode<Value>)
+                                           : sizeof(container_memory::HashedNode<Value>);
+    std::size_t buckets =
+        container.bucket_count() > 1 ? container_memory::allocated_bytes(container.bucket_count() * sizeof(void *)) : 0;
+    return container.size() * container_memory::allocated_bytes(node_bytes) + buckets;
+}
+
+template <typename T> std::size_t vector_bytes(const std::vector<T> &vector) { return vector.capacity() * sizeof(T); }
+
+#endif // CONTAINER_MEMORY_HPP
@@ -0,0 +1,101 @@
+#include "epoch_reclaimer.hpp"
+#include <algorithm>
+#include <functional>
+#include <thread>
+
+namespace {
+/// where the calling thread starts looking for a free reader slot, spreading threads over the slots.
+std::size_t slot_hint() {
+    thread_local std::size_t hint = std::hash<std::thread::id>{}(std::this_thread::get_id());
+    return hint;
+}
+} // namespace
+
+EpochReclaimer::Guard::Guard(EpochReclaimer *reclaimer, std::size_t slot) : reclaimer(reclaimer), slot(slot) {}
+
+EpochReclaimer::Guard::Guard(Guard &&other) noexcept : reclaimer(other.reclaimer), slot(other.slot) {
+    other.reclaimer = nullptr;
+}
+
+EpochReclaimer::Guard::~Guard() {
+    if (reclaimer) {
+        reclaimer->unpin(slot);
+    }
+}
+
+EpochReclaimer::~EpochReclaimer() {
+    for (const Retired &entry : retired) {
+        entry.deleter(entry.ptr);
+    }
+}
+
+EpochReclaimer::Guard EpochReclaimer::pin() {
+    for (std::size_t slot = slot_hint() % max_readers;; slot = (slot + 1) % max_readers) {
+        std::uint64_t expected = inactive;
+        if (reader_slots[slot].epoch.load(std::memory_order_relaxed) != inactive) {
+            continue;
+        }
+
+        // announcing the epoch and reading shared memory afterwards are both sequentially consistent, so a writer
+        // that advances the epoch later is guaranteed to see this slot
+        std::uint64_t epoch = global_epoch.load(std::memory_order_seq_cst);
+        if (reader_slots[slot].epoch.compare_exchange_strong(expected, epoch, std::memory_order_seq_cst)) {
+            return Guard(this, slot);
+        }
+    }
+}
+
+void EpochReclaimer::unpin(std::size_t slot) { reader_slots[slot].epoch.store(inactive, std::memory_order_release); }
+
+void EpochReclaimer::retire(void *ptr, void (*deleter)(void *), std::size_t bytes) {
+    std::lock_guard<std::mutex> lock(retired_mutex);
+    retired.push_back({ptr, deleter, global_epoch.load(std::memory_order_seq_cst), bytes});
+    retired_bytes += bytes;
+
+    if (++retired_since_collect >= collect_interval) {
+        retired_since_collect = 0;
+        try_advance();
+        free_expired();
+    }
+}
+
+void EpochReclaimer::collect() {
+    std::lock_guard<std::mutex> lock(retired_mutex);
+    retired_since_collect = 0;
+    try_advance();
+    free_expired();
+}
+
+std::size_t EpochReclaimer::get_pending_count() const {
+    std::lock_guard<std::mutex> lock(retired_mutex);
+    return retired.size();
+}
+
+std::size_t EpochReclaimer::get_pending_bytes() const {
+    std::lock_guard<std::mutex> lock(retired_mutex);
+    return retired_bytes + retired.capacity() * sizeof(Retired);
+}
+
+void EpochReclaimer::try_advance() {
+    std::uint64_t epoch = global_epoch.load(std::memory_order_seq_cst);
+    for (const ReaderSlot &slot : reader_slots) {
+        std::uint64_t pinned = slot.epoch.load(std::memory_order_seq_cst);
+        if (pinned != inactive && pinned != epoch) {
+            return;
+        }
+    }
+    global_epoch.store(epoch + 1, std::memory_order_seq_cst);
+}
+
+void EpochReclaimer::free_expired() {
+    // a reader that may still hold the allocation pinned the retire epoch or the one before it, and the global
+    // epoch can't move two past the retire epoch while such a reader is pinned
+    std::uint64_t epoch = global_epoch.load(std::memory_order_seq_cst);
+    auto expired = std::partition(retired.begin(), retired.end(),
+                                  [epoch](const Retired &entry) { return entry.epoch + 2 > epoch; });
+    for (auto it = expired; it != retired.end(); ++it) {
+        it->deleter(it->ptr);
+        retired_bytes -= it->bytes;
+    }
+    retired.erase(expired, retired.end());
+}
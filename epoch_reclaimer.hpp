@@ -0,0 +1,119 @@
+#ifndef EPOCH_RECLAIMER_HPP
+#define EPOCH_RECLAIMER_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+/**
+ * @class EpochReclaimer
+ * @brief Defers freeing memory that lock free readers may still be traversing until no reader can reach it.
+ *
+ * A reader pins the current global epoch for the duration of a traversal. A writer first unlinks a node so new
+ * readers can't find it, then retires it, tagging it with the epoch at that point. The global epoch only advances
+ * once every pinned reader has seen the current one, so after it moved forward twice no reader that could have
+ * seen the node is left and the node is freed together with everything else retired in the same epoch.
+ *
+ * Pinning is wait free apart from finding an unused reader slot and never waits for writers. Retiring takes a
+ * mutex, so writers may block each other but never a reader.
+ */
+class EpochReclaimer {
+  public:
+    /**
+     * @class Guard
+     * @brief Keeps an epoch pinned while it's alive, see pin.
+     */
+    class Guard {
+      public:
+        Guard(Guard &&other) noexcept;
+        Guard(const Guard &) = delete;
+        Guard &operator=(const Guard &) = delete;
+        Guard &operator=(Guard &&) = delete;
+        ~Guard();
+
+      private:
+        friend class EpochReclaimer;
+        Guard(EpochReclaimer *reclaimer, std::size_t slot);
+
+        EpochReclaimer *reclaimer;
+        std::size_t slot;
+    };
+
+    EpochReclaimer() = default;
+    EpochReclaimer(const EpochReclaimer &) = delete;
+    EpochReclaimer &operator=(const EpochReclaimer &) = delete;
+
+    /// frees everything still retired, no reader may be pinned anymore.
+    ~EpochReclaimer();
+
+    /**
+     * @brief Pins the current epoch, memory reachable after this call stays valid until the guard is destroyed.
+     *
+     * There are max_readers slots for pinned readers, a reader that finds all of them in use spins until one frees.
+     */
+    Guard pin();
+
+    /**
+     * @brief Frees ptr with deleter once no pinned reader can still reach it.
+     *
+     * The caller must already have made ptr unreachable for readers that pin after this call.
+     *
+     * @param bytes What ptr holds, only counted by get_pending_bytes.
+     */
+    void retire(void *ptr, void (*deleter)(void *), std::size_t bytes = 0);
+
+    template <typename T> void retire(T *ptr, std::size_t bytes = sizeof(T)) {
+        retire(static_cast<void *>(ptr), [](void *p) { delete static_cast<T *>(p); }, bytes);
+    }
+
+    /**
+     * @brief Tries to advance the epoch and frees every batch no reader can reach anymore.
+     *
+     * retire does this on its own every collect_interval retirements.
+     */
+    void collect();
+
+    /// the number of retired allocations that haven't been freed yet.
+    std::size_t get_pending_count() const;
+
+    /// the bytes passed to retire for the allocations that haven't been freed yet, plus the bookkeeping for them.
+    std::size_t get_pending_bytes() const;
+
+    static constexpr std::size_t max_readers = 128;
+    static constexpr std::size_t collect_interval = 64;
+
+  private:
+    static constexpr std::uint64_t inactive = UINT64_MAX;
+
+    /// one reader slot per cache line, so pinning readers don't contend on the same line.
+    struct alignas(64) ReaderSlot {
+        std::atomic<std::uint64_t> epoch{inactive};
+    };
+
+    struct Retired {
+        void *ptr;
+        void (*deleter)(void *);
+        std::uint64_t epoch;
+        std::size_t bytes;
+    };
+
+    std::atomic<std::uint64_t> global_epoch{0};
+    std::array<ReaderSlot, max_readers> reader_slots;
+
+    mutable std::mutex retired_mutex;
+    std::vector<Retired> retired;
+    std::size_t retired_since_collect = 0;
+    std::size_t retired_bytes = 0;
+
+    void unpin(std::size_t slot);
+
+    /// advances the global epoch if every pinned reader has seen the current one, needs retired_mutex.
+    void try_advance();
+
+    /// frees every retired allocation at least two epochs old, needs retired_mutex.
+    void free_expired();
+};
+
+#endif // EPOCH_RECLAIMER_HPP
@@ -0,0 +1,287 @@
+#include "event_sampler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <random>
+
+namespace {
+constexpr char trace_magic[8] = {'E', 'V', 'S', 'A', 'M', 'P', 'L', '1'};
+
+std::atomic<std::uint64_t> next_instance{1};
+
+/// the tag of the innermost ScopedTag alive on this thread.
+thread_local std::uint16_t current_tag = 0;
+
+template <typename T> void write_value(std::ofstream &file, const T &value) {
+    file.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template <typename T> bool read_value(std::ifstream &file, T &value) {
+    return static_cast<bool>(file.read(reinterpret_cast<char *>(&value), sizeof(value)));
+}
+
+/// ring positions are masked instead of taken modulo the capacity.
+std::size_t round_up_to_power_of_two(std::size_t value) {
+    std::size_t power = 1;
+    while (power < value) {
+        power <<= 1;
+    }
+    return power;
+}
+
+void write_block_header(std::ofstream &file, std::uint32_t kind, std::uint32_t thread, std::uint64_t count) {
+    write_value(file, kind);
+    write_value(file, thread);
+    write_value(file, count);
+}
+} // namespace
+
+EventSampler::ScopedTag::ScopedTag(std::uint16_t tag) : previous(current_tag) { current_tag = tag; }
+
+EventSampler::ScopedTag::~ScopedTag() { current_tag = previous; }
+
+EventSampler::Ring::Ring(std::size_t capacity, std::uint32_t thread_index)
+    : slots(capacity), thread_index(thread_index) {}
+
+EventSampler::EventSampler(Mode mode, std::uint64_t rate, std::size_t ring_capacity)
+    : mode(mode), rate(rate), ring_capacity(round_up_to_power_of_two(ring_capacity)),
+      instance(next_instance.fetch_add(1, std::memory_order_relaxed)), created_at(now()) {}
+
+EventSampler::~EventSampler() { stop_draining(); }
+
+std::uint64_t EventSampler::next_interval() const {
+    if (rate == 0) {
+        return std::numeric_limits<std::uint64_t>::max();
+    }
+    if (mode == Mode::every_nth || rate == 1) {
+        return rate;
+    }
+
+    // the gaps between the events of a poisson process with one event per rate operations are geometric
+    thread_local std::mt19937_64 generator(std::hash<std::thread::id>()(std::this_thread::get_id()) ^
+                                           static_cast<std::uint64_t>(now()));
+    double uniform = 1.0 - std::generate_canonical<double, 64>(generator);
+    double gap = std::floor(std::log(uniform) / std::log1p(-1.0 / static_cast<double>(rate)));
+    if (gap >= static_cast<double>(std::numeric_limits<std::uint64_t>::max() - 1)) {
+        return std::numeric_limits<std::uint64_t>::max();
+    }
+    return 1 + static_cast<std::uint64_t>(gap);
+}
+
+std::uint64_t EventSampler::now() {
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+}
+
+EventSampler::Ring &EventSampler::ring_of_calling_thread() {
+    // a thread usually feeds a single sampler, so one cached ring spares the lookup under the mutex
+    thread_local std::uint64_t cached_instance = 0;
+    thread_local Ring *cached_ring = nullptr;
+    if (cached_instance == instance) {
+        return *cached_ring;
+    }
+
+    std::lock_guard<std::mutex> lock(rings_mutex);
+    Ring *&ring = ring_of_thread[std::this_thread::get_id()];
+    if (!ring) {
+        rings.push_back(std::make_unique<Ring>(ring_capacity, static_cast<std::uint32_t>(rings.size())));
+        ring = rings.back().get();
+    }
+    cached_instance = instance;
+    cached_ring = ring;
+    return *ring;
+}
+
+void EventSampler::record(EventKind kind, int id, unsigned int start, unsigned int length, std::uint64_t began) {
+    std::uint64_t finished = now();
+    Ring &ring = ring_of_calling_thread();
+
+    std::uint64_t head = ring.head.load(std::memory_order_relaxed);
+    if (head - ring.tail.load(std::memory_order_acquire) == ring.slots.size()) {
+        ring.dropped.store(ring.dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return;
+    }
+
+    ring.slots[head & (ring.slots.size() - 1)] = {finished, finished - began, id, start, length, current_tag, kind, 0};
+    ring.head.store(head + 1, std::memory_order_release);
+}
+
+std::uint16_t EventSampler::register_tag(const std::string &name) {
+    std::lock_guard<std::mutex> lock(rings_mutex);
+    auto existing = std::find(tag_names.begin(), tag_names.end(), name);
+    if (existing != tag_names.end()) {
+        return static_cast<std::uint16_t>(existing - tag_names.begin() + 1);
+    }
+    if (tag_names.size() >= std::numeric_limits<std::uint16_t>::max()) {
+        return 0;
+    }
+    tag_names.push_back(name);
+    return static_cast<std::uint16_t>(tag_names.size());
+}
+
+bool EventSampler::start_draining(const std::string &path, std::chrono::milliseconds interval) {
+    {
+        std::lock_guard<std::mutex> lock(drain_mutex);
+        if (file.is_open()) {
+            return false;
+        }
+        file.open(path, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            file.close();
+            return false;
+        }
+        file.write(trace_magic, sizeof(trace_magic));
+        write_value(file, created_at);
+
+        // a new file needs every name again
+        std::lock_guard<std::mutex> rings_lock(rings_mutex);
+        written_tags = 0;
+    }
+
+    stop_requested = false;
+    drain_thread = std::thread(&EventSampler::drain_loop, this, interval);
+    return true;
+}
+
+void EventSampler::stop_draining() {
+    if (!drain_thread.joinable()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(stop_mutex);
+        stop_requested = true;
+    }
+    stop_condition.notify_one();
+    drain_thread.join();
+
+    drain();
+    std::lock_guard<std::mutex> lock(drain_mutex);
+    file.close();
+}
+
+void EventSampler::drain_loop(std::chrono::milliseconds interval) {
+    std::unique_lock<std::mutex> lock(stop_mutex);
+    while (!stop_condition.wait_for(lock, interval, [this] { return stop_requested; })) {
+        lock.unlock();
+        drain();
+        lock.lock();
+    }
+}
+
+bool EventSampler::drain() {
+    std::lock_guard<std::mutex> lock(drain_mutex);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    // rings are never freed before the sampler, so the pointers stay valid once the mutex is released
+    std::vector<Ring *> snapshot;
+    std::vector<std::string> new_tags;
+    std::size_t first_new_tag;
+    {
+        std::lock_guard<std::mutex> rings_lock(rings_mutex);
+        for (const auto &ring : rings) {
+            snapshot.push_back(ring.get());
+        }
+        first_new_tag = written_tags;
+        new_tags.assign(tag_names.begin() + static_cast<std::ptrdiff_t>(written_tags), tag_names.end());
+        written_tags = tag_names.size();
+    }
+
+    if (!new_tags.empty()) {
+        write_block_header(file, tags_block, 0, new_tags.size());
+        for (std::size_t i = 0; i < new_tags.size(); ++i) {
+            auto length = static_cast<std::uint16_t>(std::min<std::size_t>(new_tags[i].size(), UINT16_MAX));
+            write_value(file, static_cast<std::uint16_t>(first_new_tag + i + 1));
+            write_value(file, length);
+            file.write(new_tags[i].data(), length);
+        }
+    }
+
+    for (Ring *ring : snapshot) {
+        std::uint64_t head = ring->head.load(std::memory_order_acquire);
+        std::uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+        if (head == tail) {
+            continue;
+        }
+
+        // the events may wrap around the end of the slots, which splits them into two writes
+        write_block_header(file, events_block, ring->thread_index, head - tail);
+        std::size_t mask = ring->slots.size() - 1;
+        std::size_t first = tail & mask;
+        std::size_t count = head - tail;
+        std::size_t before_wrap = std::min(count, ring->slots.size() - first);
+        file.write(reinterpret_cast<const char *>(ring->slots.data() + first),
+                   static_cast<std::streamsize>(before_wrap * sizeof(Event)));
+        file.write(reinterpret_cast<const char *>(ring->slots.data()),
+                   static_cast<std::streamsize>((count - before_wrap) * sizeof(Event)));
+        ring->tail.store(head, std::memory_order_release);
+    }
+
+    file.flush();
+    return static_cast<bool>(file);
+}
+
+std::uint64_t EventSampler::get_recorded_count() const {
+    std::lock_guard<std::mutex> lock(rings_mutex);
+    std::uint64_t recorded = 0;
+    for (const auto &ring : rings) {
+        recorded += ring->head.load(std::memory_order_relaxed);
+    }
+    return recorded;
+}
+
+std::uint64_t EventSampler::get_dropped_count() const {
+    std::lock_guard<std::mutex> lock(rings_mutex);
+    std::uint64_t dropped = 0;
+    for (const auto &ring : rings) {
+        dropped += ring->dropped.load(std::memory_order_relaxed);
+    }
+    return dropped;
+}
+
+std::optional<EventSampler::Trace> EventSampler::read_trace(const std::string &path) {
+    std::ifstream file(path, std::ios::binary);
+    char magic[sizeof(trace_magic)];
+    Trace trace;
+    if (!file.read(magic, sizeof(magic)) || std::memcmp(magic, trace_magic, sizeof(magic)) != 0 ||
+        !read_value(file, trace.created_at)) {
+        return std::nullopt;
+    }
+
+    std::uint32_t kind;
+    std::uint32_t thread;
+    std::uint64_t count;
+    while (read_value(file, kind) && read_value(file, thread) && read_value(file, count)) {
+        if (kind != events_block && kind != tags_block) {
+            return std::nullopt;
+        }
+        for (std::uint64_t i = 0; i < count; ++i) {
+            if (kind == events_block) {
+                Event event;
+                if (!read_value(file, event)) {
+                    return trace;
+                }
+                trace.events.emplace_back(thread, event);
+                continue;
+            }
+
+            std::uint16_t tag;
+            std::uint16_t length;
+            std::string name;
+            if (!read_value(file, tag) || !read_value(file, length)) {
+                return trace;
+            }
+            name.resize(length);
+            if (!file.read(name.data(), length)) {
+                return trace;
+            }
+            trace.tag_names[tag] = std::move(name);
+        }
+    }
+    return trace;
+}
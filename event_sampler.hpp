@@ -0,0 +1,193 @@
+#ifndef EVENT_SAMPLER_HPP
+#define EVENT_SAMPLER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @class EventSampler
+ * @brief Captures a sample of the allocations and frees of the trackers it is attached to, for production tracing.
+ *
+ * A tracker counts its operations down to the next sample itself, see next_interval, so an operation that isn't
+ * sampled costs one decrement and one branch and never reads a clock. A sampled one is timed and written, with the
+ * call-site tag of the thread, into a ring buffer owned by the calling thread that only that thread writes and only
+ * the drain reads, so recording takes no lock. A full ring drops the event and counts the drop.
+ *
+ * The rings are drained into a binary file, periodically by a background thread or by calling drain. The file is
+ * a header followed by blocks in host byte order:
+ *
+ *     header: char magic[8] = "EVSAMPL1", std::uint64_t steady clock nanoseconds at which the sampler was created
+ *     block:  std::uint32_t kind, std::uint32_t thread, std::uint64_t count, then the payload
+ *
+ * A block of kind events holds count Event records written by the thread with that index, a block of kind tags
+ * holds count names of tags registered since the previous one, each an std::uint16_t tag, an std::uint16_t length
+ * and that many bytes. read_trace reads a file back.
+ */
+class EventSampler {
+  public:
+    enum class Mode {
+        /// exactly every rate-th operation of a tracker.
+        every_nth,
+        /// operations at exponentially distributed gaps with a mean of rate, so periodic patterns in the workload
+        /// can't line up with the samples.
+        poisson
+    };
+
+    enum class EventKind : std::uint8_t { allocation, failed_allocation, free };
+
+    /**
+     * @brief One sampled operation, 32 bytes as written to the file.
+     */
+    struct Event {
+        /// when the operation finished, in steady clock nanoseconds.
+        std::uint64_t timestamp;
+        std::uint64_t latency_nanoseconds;
+        std::int32_t id;
+        std::uint32_t start;
+        std::uint32_t length;
+        std::uint16_t tag;
+        EventKind kind;
+        std::uint8_t reserved;
+    };
+    static_assert(sizeof(Event) == 32, "events are written to the file as they are");
+
+    enum BlockKind : std::uint32_t { events_block = 1, tags_block = 2 };
+
+    /**
+     * @class ScopedTag
+     * @brief Tags the events the current thread records while it is alive, restoring the previous tag afterwards.
+     */
+    class ScopedTag {
+      public:
+        /// tag is a value returned by register_tag, 0 is untagged.
+        explicit ScopedTag(std::uint16_t tag);
+        ScopedTag(const ScopedTag &) = delete;
+        ScopedTag &operator=(const ScopedTag &) = delete;
+        ~ScopedTag();
+
+      private:
+        std::uint16_t previous;
+    };
+
+    /**
+     * @brief A trace read back from a file.
+     */
+    struct Trace {
+        std::uint64_t created_at = 0;
+        /// the events of every block with the index of the thread that recorded them, in file order.
+        std::vector<std::pair<std::uint32_t, Event>> events;
+        std::map<std::uint16_t, std::string> tag_names;
+    };
+
+    /**
+     * @param rate The mean number of operations per sample, 1 samples everything and 0 nothing.
+     * @param ring_capacity The events each thread can hold between drains, rounded up to a power of two.
+     */
+    EventSampler(Mode mode, std::uint64_t rate, std::size_t ring_capacity = 4096);
+    EventSampler(const EventSampler &) = delete;
+    EventSampler &operator=(const EventSampler &) = delete;
+
+    /// stops draining if it still is, trackers must be detached before.
+    ~EventSampler();
+
+    /**
+     * @brief The number of operations until the next sample, drawn anew for every sample.
+     *
+     * Safe from any thread. With a rate of 0 it is so large the countdown never runs out.
+     */
+    std::uint64_t next_interval() const;
+
+    /// the steady clock in nanoseconds, which events are timed with.
+    static std::uint64_t now();
+
+    /**
+     * @brief Writes a sampled event into the ring of the calling thread.
+     * @param began The value of now when the operation started.
+     */
+    void record(EventKind kind, int id, unsigned int start, unsigned int length, std::uint64_t began);
+
+    /**
+     * @brief The tag for a call-site name, the same name always gets the same tag.
+     * @return A tag above 0, or 0 if all 65535 tags are taken.
+     */
+    std::uint16_t register_tag(const std::string &name);
+
+    /**
+     * @brief Creates the file, writing its header, and drains into it every interval on a background thread.
+     * @return False if it is already draining or the file can't be created.
+     */
+    bool start_draining(const std::string &path, std::chrono::milliseconds interval);
+
+    /// drains one last time, stops the thread and closes the file, does nothing if it isn't draining.
+    void stop_draining();
+
+    /**
+     * @brief Moves every event recorded so far into the file now.
+     * @return False if it isn't draining or the write failed.
+     */
+    bool drain();
+
+    /// the number of events recorded and dropped because a ring was full, summed over all threads.
+    std::uint64_t get_recorded_count() const;
+    std::uint64_t get_dropped_count() const;
+
+    /**
+     * @brief Reads a file written while draining.
+     * @return std::nullopt if it can't be read or isn't a trace, a trace cut off in a block keeps the complete events.
+     */
+    static std::optional<Trace> read_trace(const std::string &path);
+
+  private:
+    /// single producer single consumer, head is only written by the owning thread and tail only by the drain.
+    struct Ring {
+        explicit Ring(std::size_t capacity, std::uint32_t thread_index);
+
+        std::vector<Event> slots;
+        std::uint32_t thread_index;
+        alignas(64) std::atomic<std::uint64_t> head{0};
+        std::atomic<std::uint64_t> dropped{0};
+        alignas(64) std::atomic<std::uint64_t> tail{0};
+    };
+
+    const Mode mode;
+    const std::uint64_t rate;
+    const std::size_t ring_capacity;
+
+    /// tells the rings of different samplers apart in the per-thread cache, addresses can be reused.
+    const std::uint64_t instance;
+    const std::uint64_t created_at;
+
+    /// guards rings, ring_of_thread, tag_names and written_tags.
+    mutable std::mutex rings_mutex;
+    std::vector<std::unique_ptr<Ring>> rings;
+    std::map<std::thread::id, Ring *> ring_of_thread;
+    std::vector<std::string> tag_names;
+    std::size_t written_tags = 0;
+
+    /// serializes drains and guards the file.
+    std::mutex drain_mutex;
+    std::ofstream file;
+
+    std::mutex stop_mutex;
+    std::condition_variable stop_condition;
+    bool stop_requested = false;
+    std::thread drain_thread;
+
+    /// the ring of the calling thread, created on its first event.
+    Ring &ring_of_calling_thread();
+
+    void drain_loop(std::chrono::milliseconds interval);
+};
+
+#endif // EVENT_SAMPLER_HPP
@@ -1,115 +1,1672 @@
 #include "fixed_size_array_tracker.hpp"
+#include "container_memory.hpp"
+#include "tracker_registry.hpp"
 #include <vector>
 #include <string>
 #include <sstream>
+#include <iterator>
+#include <algorithm>
+#include <cmath>
 
-FixedSizeArrayTracker::FixedSizeArrayTracker(unsigned int size, LogSection::LogMode log_mode)
-    : size(size), log_mode(log_mode) {}
+FixedSizeArrayTracker::FixedSizeArrayTracker(unsigned int size, LogSection::LogMode log_mode,
+                                             unsigned int granule_size)
+    : size(size), log_mode(log_mode), granule_size(granule_size == 0 ? 1 : granule_size),
+      granule_count(size / this->granule_size), occupied_intervals(granule_count) {
+    if (granule_count > 0) {
+        insert_gap(0, granule_count);
+    }
+    publish_counters();
+}
+
+FixedSizeArrayTracker::~FixedSizeArrayTracker() { TrackerRegistry::instance().remove(this); }
+
+unsigned int FixedSizeArrayTracker::granules_for(unsigned int length) const {
+    return static_cast<unsigned int>((static_cast<unsigned long long>(length) + granule_size - 1) / granule_size);
+}
+
+void FixedSizeArrayTracker::insert_gap(unsigned int start, unsigned int end) {
+    free_gaps.emplace(start, end);
+    free_gaps_by_length.insert({end - start, start});
+    if (radix_gaps) {
+        radix_gaps->insert(start, end);
+    }
+}
+
+void FixedSizeArrayTracker::erase_gap(std::map<unsigned int, unsigned int>::iterator gap) {
+    free_gaps_by_length.erase({gap->second - gap->first, gap->first});
+    if (radix_gaps) {
+        radix_gaps->erase(gap->first);
+    }
+    free_gaps.erase(gap);
+}
+
+bool FixedSizeArrayTracker::is_free(unsigned int start, unsigned int length) const {
+    if (length == 0) {
+        // an empty region only collides if it sits strictly inside an occupied interval
+        if (radix_regions) {
+            auto previous = start == 0 ? std::nullopt : radix_regions->predecessor(start - 1);
+            return !previous || radix_regions->find(*previous)->end <= start;
+        }
+        auto next = occupied_intervals.lower_bound(start);
+        if (next == occupied_intervals.begin()) {
+            return true;
+        }
+        return (*--next).end <= start;
+    }
+
+    // the only gap that can contain the range is the last one starting at or before it
+    if (radix_gaps) {
+        auto gap_start = radix_gaps->predecessor(start);
+        return gap_start && static_cast<unsigned long long>(start) + length <= radix_gaps->find(*gap_start)->end;
+    }
+    auto gap = free_gaps.upper_bound(start);
+    if (gap == free_gaps.begin()) {
+        return false;
+    }
+    --gap;
+    return static_cast<unsigned long long>(start) + length <= gap->second;
+}
+
+void FixedSizeArrayTracker::occupy_granules(unsigned int start, unsigned int length) {
+    if (length == 0) {
+        return;
+    }
+
+    auto gap = std::prev(free_gaps.upper_bound(start));
+    unsigned int gap_start = gap->first;
+    unsigned int gap_end = gap->second;
+    erase_gap(gap);
+
+    // keep whatever is left on either side of the occupied range
+    if (gap_start < start) {
+        insert_gap(gap_start, start);
+    }
+    if (start + length < gap_end) {
+        insert_gap(start + length, gap_end);
+    }
+}
+
+void FixedSizeArrayTracker::release_granules(unsigned int start, unsigned int length) {
+    if (length == 0) {
+        return;
+    }
+
+    unsigned int end = start + length;
+
+    auto next = free_gaps.lower_bound(start);
+    if (next != free_gaps.end() && next->first == end) {
+        end = next->second;
+        erase_gap(next++);
+    }
+
+    if (next != free_gaps.begin()) {
+        auto prev = std::prev(next);
+        if (prev->second == start) {
+            start = prev->first;
+            erase_gap(prev);
+        }
+    }
+
+    insert_gap(start, end);
+}
+
+void FixedSizeArrayTracker::flush_quick_lists() {
+    if (quick_list_entries == 0) {
+        return;
+    }
+
+    for (const auto &[length_in_granules, starts] : quick_lists) {
+        for (unsigned int start : starts) {
+            release_granules(start, length_in_granules);
+        }
+    }
+    quick_lists.clear();
+    quick_list_entries = 0;
+    quick_list_granules = 0;
+    quick_list_stats.flushes++;
+}
+
+double FixedSizeArrayTracker::QuickListStats::hit_rate() const {
+    unsigned long long searches = hits + misses;
+    return searches == 0 ? 0.0 : static_cast<double>(hits) / searches;
+}
+
+void FixedSizeArrayTracker::set_quick_list_limit(unsigned int max_entries) {
+    quick_list_limit = max_entries;
+    if (quick_list_entries > quick_list_limit) {
+        flush_quick_lists();
+        check_watermarks();
+    }
+}
+
+FixedSizeArrayTracker::QuickListStats FixedSizeArrayTracker::get_quick_list_stats() const { return quick_list_stats; }
+
+std::uint64_t FixedSizeArrayTracker::fingerprint_region(int id, unsigned int start, unsigned int length) {
+    // splitmix64 finalizer over the packed triple, so that similar triples land far apart
+    std::uint64_t x = static_cast<std::uint32_t>(id);
+    x = x * 0x9E3779B97F4A7C15ull + start;
+    x = x * 0x9E3779B97F4A7C15ull + length;
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ull;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBull;
+    x ^= x >> 31;
+    return x;
+}
+
+std::uint64_t FixedSizeArrayTracker::get_layout_fingerprint() const { return layout_fingerprint; }
+
+void FixedSizeArrayTracker::mark_dirty(unsigned int start, unsigned int end) {
+    // past the bound the ranges are folded into one that covers them all, which keeps marking O(1)
+    if (dirty_ranges.size() >= max_dirty_ranges) {
+        unsigned int lowest = start;
+        unsigned int highest = end;
+        for (const auto &[dirty_start, dirty_end] : dirty_ranges) {
+            lowest = std::min(lowest, dirty_start);
+            highest = std::max(highest, dirty_end);
+        }
+        dirty_ranges.assign(1, {lowest, highest});
+        return;
+    }
+    dirty_ranges.emplace_back(start, end);
+}
+
+void FixedSizeArrayTracker::fill_bits(std::uint64_t *words, std::size_t begin, std::size_t end, bool value) {
+    if (begin >= end) {
+        return;
+    }
+
+    std::size_t first_word = begin / 64;
+    std::size_t last_word = (end - 1) / 64;
+    std::uint64_t first_mask = ~std::uint64_t(0) << (begin % 64);
+    std::uint64_t last_mask = ~std::uint64_t(0) >> (63 - (end - 1) % 64);
+
+    auto apply = [&](std::size_t word, std::uint64_t mask) {
+        words[word] = value ? (words[word] | mask) : (words[word] & ~mask);
+    };
+
+    if (first_word == last_word) {
+        apply(first_word, first_mask & last_mask);
+        return;
+    }
+    apply(first_word, first_mask);
+    std::fill(words + first_word + 1, words + last_word, value ? ~std::uint64_t(0) : 0);
+    apply(last_word, last_mask);
+}
+
+std::size_t FixedSizeArrayTracker::occupancy_bitset_words(OccupancyUnit unit) const {
+    std::size_t bits = unit == OccupancyUnit::granule ? granule_count : size;
+    return (bits + 63) / 64;
+}
+
+void FixedSizeArrayTracker::fill_occupancy(std::uint64_t *words, OccupancyUnit unit, unsigned int start,
+                                           unsigned int end) const {
+    // start with the interval that could begin before the range but still reach into it
+    auto region = occupied_intervals.lower_bound(start);
+    if (region != occupied_intervals.begin()) {
+        auto previous = region;
+        if ((*--previous).end > start) {
+            region = previous;
+        }
+    }
+
+    for (; region != occupied_intervals.end() && (*region).start < end; ++region) {
+        auto interval = *region;
+        if (unit == OccupancyUnit::granule) {
+            fill_bits(words, std::max(interval.start, start), std::min(interval.end, end), true);
+        } else {
+            const auto &range = metadata.at(interval.id);
+            std::size_t range_start = range.first;
+            std::size_t range_end = static_cast<std::size_t>(range.first) + range.second;
+            fill_bits(words, std::max<std::size_t>(range_start, std::size_t(start) * granule_size),
+                      std::min<std::size_t>(range_end, std::size_t(end) * granule_size), true);
+        }
+    }
+}
+
+bool FixedSizeArrayTracker::export_occupancy_bitset(std::uint64_t *words, std::size_t word_count,
+                                                    OccupancyUnit unit) {
+    if (word_count < occupancy_bitset_words(unit)) {
+        return false;
+    }
+
+    std::fill(words, words + occupancy_bitset_words(unit), 0);
+    fill_occupancy(words, unit, 0, granule_count);
+    dirty_ranges.clear();
+    return true;
+}
+
+bool FixedSizeArrayTracker::update_occupancy_bitset(std::uint64_t *words, std::size_t word_count,
+                                                    OccupancyUnit unit) {
+    if (word_count < occupancy_bitset_words(unit)) {
+        return false;
+    }
+
+    // overlapping dirty ranges are merged so no part of the bitset is rebuilt twice
+    std::sort(dirty_ranges.begin(), dirty_ranges.end());
+    std::size_t i = 0;
+    while (i < dirty_ranges.size()) {
+        unsigned int start = dirty_ranges[i].first;
+        unsigned int end = dirty_ranges[i].second;
+        for (++i; i < dirty_ranges.size() && dirty_ranges[i].first <= end; ++i) {
+            end = std::max(end, dirty_ranges[i].second);
+        }
+
+        std::size_t scale = unit == OccupancyUnit::granule ? 1 : granule_size;
+        fill_bits(words, std::size_t(start) * scale, std::size_t(end) * scale, false);
+        fill_occupancy(words, unit, start, end);
+    }
+
+    dirty_ranges.clear();
+    return true;
+}
+
+unsigned int FixedSizeArrayTracker::reserved_granules_for(unsigned int length) const {
+    return granules_for(size_classes.round_up(length));
+}
+
+unsigned int FixedSizeArrayTracker::reserved_granules_of(unsigned int start, unsigned int length) const {
+    if (length == 0) {
+        return 0;
+    }
+    // non-empty regions never share a start, so the interval at the start is the region's
+    unsigned int start_granule = start / granule_size;
+    if (radix_regions) {
+        return radix_regions->find(start_granule)->end - start_granule;
+    }
+    return (*occupied_intervals.find(start_granule)).end - start_granule;
+}
+
+void FixedSizeArrayTracker::index_region(int id, unsigned int start, unsigned int length,
+                                         unsigned int length_in_granules) {
+    unsigned int start_granule = start / granule_size;
+    std::pair<unsigned int, unsigned int> interval = {start_granule, start_granule + length_in_granules};
+
+    metadata[id] = {start, length};
+    used_elements += length;
+    used_granules += length_in_granules;
+    layout_fingerprint += fingerprint_region(id, start, length);
+    publish_region(id, start, length);
+
+    // empty regions occupy nothing and are only tracked in metadata
+    if (length_in_granules == 0) {
+        return;
+    }
+
+    occupied_intervals.insert(interval.first, interval.second, id);
+    if (radix_regions) {
+        radix_regions->insert(interval.first, interval.second, id);
+    }
+    if (concurrent_intervals && mirror_intervals) {
+        concurrent_intervals->insert(interval.first, interval.second, id);
+    }
+    mark_dirty(interval.first, interval.second);
+
+    auto lifetime = region_lifetimes.find(id);
+    if (lifetime != region_lifetimes.end()) {
+        auto index = static_cast<std::size_t>(lifetime->second);
+        lifetime_intervals[index].insert(interval);
+        lifetime_used_granules[index] += length_in_granules;
+    }
+}
+
+unsigned int FixedSizeArrayTracker::unindex_region(int id) {
+    auto it = metadata.find(id);
+    auto [start, length] = it->second;
+    unsigned int start_granule = start / granule_size;
+    unsigned int length_in_granules = reserved_granules_of(start, length);
+    std::pair<unsigned int, unsigned int> interval = {start_granule, start_granule + length_in_granules};
+
+    // an empty region may share its start with a non-empty one, but it was never in the interval index
+    if (length_in_granules > 0 && occupied_intervals.erase(interval.first)) {
+        if (radix_regions) {
+            radix_regions->erase(interval.first);
+        }
+        if (concurrent_intervals && mirror_intervals) {
+            concurrent_intervals->remove(interval.first);
+        }
+        mark_dirty(interval.first, interval.second);
+    }
+    used_elements -= length;
+    used_granules -= length_in_granules;
+    layout_fingerprint -= fingerprint_region(id, start, length);
+
+    auto lifetime = region_lifetimes.find(id);
+    if (lifetime != region_lifetimes.end() && length_in_granules > 0) {
+        auto index = static_cast<std::size_t>(lifetime->second);
+        lifetime_intervals[index].erase(interval);
+        lifetime_used_granules[index] -= length_in_granules;
+    }
+
+    metadata.erase(it);
+    return length_in_granules;
+}
+
+FixedSizeArrayTracker::LifetimeStats FixedSizeArrayTracker::get_lifetime_stats(Lifetime lifetime) const {
+    auto index = static_cast<std::size_t>(lifetime);
+    const auto &intervals = lifetime_intervals[index];
+
+    LifetimeStats stats;
+    stats.regions = static_cast<unsigned int>(intervals.size());
+    stats.reserved_elements = lifetime_used_granules[index] * granule_size;
+    if (!intervals.empty()) {
+        unsigned int span = intervals.rbegin()->second - intervals.begin()->first;
+        stats.span_elements = span * granule_size;
+        stats.fragmentation = span == 0 ? 0.0 : 1.0 - static_cast<double>(lifetime_used_granules[index]) / span;
+    }
+    return stats;
+}
+
+unsigned int FixedSizeArrayTracker::get_largest_free_block() const {
+    return free_gaps_by_length.empty() ? 0 : free_gaps_by_length.rbegin()->first * granule_size;
+}
+
+void FixedSizeArrayTracker::set_usage_watermarks(double low, double high, WatermarkCallback callback) {
+    set_watermark(watermarks[static_cast<std::size_t>(WatermarkMetric::usage)], low, high, std::move(callback),
+                  get_usage_percentage());
+}
+
+void FixedSizeArrayTracker::set_largest_free_block_watermarks(unsigned int low, unsigned int high,
+                                                              WatermarkCallback callback) {
+    set_watermark(watermarks[static_cast<std::size_t>(WatermarkMetric::largest_free_block)], low, high,
+                  std::move(callback), get_largest_free_block());
+}
+
+void FixedSizeArrayTracker::set_watermark(Watermark &watermark, double low, double high, WatermarkCallback callback,
+                                          double value) {
+    watermark.low = std::min(low, high);
+    watermark.high = std::max(low, high);
+    watermark.callback = std::move(callback);
+
+    // start from wherever the value is now, so only later crossings are reported
+    watermark.side = WatermarkSide::between;
+    if (value >= watermark.high) {
+        watermark.side = WatermarkSide::above_high;
+    } else if (value <= watermark.low) {
+        watermark.side = WatermarkSide::below_low;
+    }
+}
+
+void FixedSizeArrayTracker::check_watermarks(bool fire) {
+    // every call that changes usage or free space ends here
+    publish_counters();
+
+    // crossings are noted right away so none is missed while firing has to wait
+    for (std::size_t i = 0; i < watermarks.size(); ++i) {
+        Watermark &watermark = watermarks[i];
+        if (!watermark.callback) {
+            continue;
+        }
+
+        auto metric = static_cast<WatermarkMetric>(i);
+        double value = metric == WatermarkMetric::usage ? get_usage_percentage() : get_largest_free_block();
+
+        // each side only fires when it is entered, staying inside the band between low and high doesn't re-arm it
+        if (value >= watermark.high && watermark.side != WatermarkSide::above_high) {
+            watermark.side = WatermarkSide::above_high;
+            pending_crossings.push_back({metric, WatermarkCrossing::above_high, value});
+        } else if (value <= watermark.low && watermark.side != WatermarkSide::below_low) {
+            watermark.side = WatermarkSide::below_low;
+            pending_crossings.push_back({metric, WatermarkCrossing::below_low, value});
+        }
+    }
+
+    if (!fire || nested_operations > 0 || checking_watermarks || pending_crossings.empty()) {
+        return;
+    }
+    checking_watermarks = true;
+
+    // mutations made by a callback append their crossings to the list this loop is working through
+    for (std::size_t i = 0; i < pending_crossings.size() && i < max_watermark_callbacks; ++i) {
+        PendingCrossing crossing = pending_crossings[i];
+        // a copy, the callback may replace itself
+        WatermarkCallback callback = watermarks[static_cast<std::size_t>(crossing.metric)].callback;
+        if (callback) {
+            callback(crossing.metric, crossing.crossing, crossing.value);
+        }
+    }
+    pending_crossings.clear();
+
+    checking_watermarks = false;
+}
+
+// returns a normalized value in [0, 1]
+double FixedSizeArrayTracker::get_usage_percentage() const {
+    return (static_cast<double>(used_elements) / size);
+}
+
+FixedSizeArrayTracker::UsageStats FixedSizeArrayTracker::get_usage_stats() const {
+    UsageStats stats;
+    stats.total_elements = size;
+    stats.used_elements = used_elements;
+    stats.reserved_elements = used_granules * granule_size;
+    stats.rounding_waste = stats.reserved_elements - used_elements;
+    stats.unusable_tail = size - granule_count * granule_size;
+    return stats;
+}
+
+unsigned int FixedSizeArrayTracker::get_granule_size() const { return granule_size; }
+
+// returns the index to the space with the contiguous space
+std::optional<unsigned int> FixedSizeArrayTracker::find_contiguous_space(unsigned int length) {
+    return find_space(length, Lifetime::transient);
+}
+
+std::optional<unsigned int> FixedSizeArrayTracker::find_space(unsigned int length, Lifetime lifetime) {
+    if (profiling_enabled) {
+        allocation_profile.record_search(length);
+    }
+
+    unsigned int length_in_granules = reserved_granules_for(length);
+    auto start = search_gaps(length_in_granules, lifetime);
+    counters.add(TrackerCounters::searches);
+    counters.add(TrackerCounters::failed_searches, start ? 0 : 1);
+
+    if (adaptive_policy_enabled) {
+        observe_search(length_in_granules, start.has_value());
+    }
+
+    // a failed search may have flushed the quick lists, which changes the largest free block. the callbacks wait
+    // for the next mutation, they could make the position returned here stale
+    check_watermarks(false);
+
+    if (!start) {
+        return std::nullopt;
+    }
+    return *start * granule_size;
+}
+
+std::optional<unsigned int> FixedSizeArrayTracker::search_gaps(unsigned int length_in_granules, Lifetime lifetime) {
+    if (length_in_granules == 0) {
+        return 0;
+    }
+
+    if (quick_list_limit > 0) {
+        auto quick_list = quick_lists.find(length_in_granules);
+        if (quick_list != quick_lists.end() && !quick_list->second.empty() &&
+            in_zone(quick_list->second.back(), length_in_granules, lifetime)) {
+            quick_list_stats.hits++;
+            return quick_list->second.back();
+        }
+        quick_list_stats.misses++;
+    }
+
+    // nothing can fit if even the largest gap is too small, unless parked ranges would help once coalesced
+    if (free_gaps_by_length.empty() || free_gaps_by_length.rbegin()->first < length_in_granules) {
+        if (quick_list_entries == 0) {
+            return std::nullopt;
+        }
+        flush_quick_lists();
+        if (free_gaps_by_length.empty() || free_gaps_by_length.rbegin()->first < length_in_granules) {
+            return std::nullopt;
+        }
+    }
+
+    if (lifetime != Lifetime::transient) {
+        return search_zone(length_in_granules, lifetime);
+    }
+
+    if (placement_policy == PlacementPolicy::best_fit) {
+        // the smallest gap that fits, ties go to the lowest address
+        return free_gaps_by_length.lower_bound({length_in_granules, 0})->second;
+    }
+
+    // the interval index finds the lowest hole between regions in O(log n), which is the first fit unless parked
+    // ranges make part of that hole unavailable
+    auto hole = occupied_intervals.find_first_gap(length_in_granules);
+    if (hole && is_free(*hole, length_in_granules)) {
+        return hole;
+    }
+
+    // walk the gaps in address order so the lowest fitting position is returned
+    for (const auto &[start, end] : free_gaps) {
+        if (end - start >= length_in_granules) {
+            return start;
+        }
+    }
+
+    return std::nullopt;
+}
+
+void FixedSizeArrayTracker::set_profiling(bool enabled) { profiling_enabled = enabled; }
+
+const AllocationProfile &FixedSizeArrayTracker::get_allocation_profile() const { return allocation_profile; }
+
+void FixedSizeArrayTracker::set_event_sampler(EventSampler *sampler) {
+    event_sampler = sampler;
+    sample_countdown = sampler ? sampler->next_interval() : std::numeric_limits<std::uint64_t>::max();
+}
+
+void FixedSizeArrayTracker::set_size_classes(const SizeClassConfig &config) { size_classes = config; }
+
+void FixedSizeArrayTracker::set_placement_policy(PlacementPolicy policy) { placement_policy = policy; }
+
+FixedSizeArrayTracker::PlacementPolicy FixedSizeArrayTracker::get_placement_policy() const {
+    return placement_policy;
+}
+
+double FixedSizeArrayTracker::get_fragmentation() const {
+    // parked ranges aren't in the gap index, so they can't count towards the total either
+    unsigned int free_granules = granule_count - used_granules - quick_list_granules;
+    if (free_granules == 0 || free_gaps_by_length.empty()) {
+        return 0.0;
+    }
+    return 1.0 - static_cast<double>(free_gaps_by_length.rbegin()->first) / free_granules;
+}
+
+void FixedSizeArrayTracker::set_adaptive_policy(bool enabled, unsigned int window) {
+    adaptive_policy_enabled = enabled;
+    adaptive_window_length = window == 0 ? 1 : window;
+    adaptive_window = {};
+    sampled_births.clear();
+}
+
+const FixedSizeArrayTracker::AdaptiveStats &FixedSizeArrayTracker::get_adaptive_stats() const {
+    return adaptive_stats;
+}
+
+void FixedSizeArrayTracker::observe_search(unsigned int length_in_granules, bool found) {
+    adaptive_window.searches++;
+    adaptive_window.failures += found ? 0 : 1;
+    adaptive_window.size_sum += length_in_granules;
+    adaptive_window.size_square_sum += static_cast<double>(length_in_granules) * length_in_granules;
+
+    if (adaptive_window.searches >= adaptive_window_length) {
+        evaluate_adaptive_window();
+    }
+}
+
+void FixedSizeArrayTracker::evaluate_adaptive_window() {
+    const AdaptiveWindow &window = adaptive_window;
+    double failure_rate = static_cast<double>(window.failures) / window.searches;
+    double fragmentation = get_fragmentation();
+    double mean_size = window.size_sum / window.searches;
+    double variance = window.size_square_sum / window.searches - mean_size * mean_size;
+    double size_variation = mean_size > 0.0 ? std::sqrt(std::max(variance, 0.0)) / mean_size : 0.0;
+    double mean_lifetime = window.lifetime_samples == 0 ? 0.0 : window.lifetime_sum / window.lifetime_samples;
+
+    adaptive_stats.windows++;
+    adaptive_stats.failure_rate = failure_rate;
+    adaptive_stats.fragmentation = fragmentation;
+    adaptive_stats.size_variation = size_variation;
+    adaptive_stats.mean_lifetime = mean_lifetime;
+
+    // the window right after a switch measures its effect and isn't used to decide, which also stops flapping
+    if (!adaptive_stats.decisions.empty() && !adaptive_stats.decisions.back().measured) {
+        auto &decision = adaptive_stats.decisions.back();
+        decision.failure_rate_after = failure_rate;
+        decision.fragmentation_after = fragmentation;
+        decision.measured = true;
+        adaptive_window = {};
+        return;
+    }
+
+    // with widely varying lengths best fit keeps large gaps intact, which matters once the array is under pressure
+    // or when regions live long enough for the holes first fit leaves behind to stick around. with uniform lengths
+    // and no pressure first fit does just as well and keeps regions packed towards the bottom
+    bool struggling = failure_rate > 0.0 || fragmentation > 0.5;
+    bool varied_sizes = size_variation > 0.5;
+    bool long_lived = window.lifetime_samples > 0 && mean_lifetime >= adaptive_window_length;
+
+    PlacementPolicy next = placement_policy;
+    if (placement_policy == PlacementPolicy::first_fit && varied_sizes && (struggling || long_lived)) {
+        next = PlacementPolicy::best_fit;
+    } else if (placement_policy == PlacementPolicy::best_fit && !varied_sizes && !struggling) {
+        next = PlacementPolicy::first_fit;
+    }
+
+    if (next != placement_policy) {
+        AdaptiveDecision decision;
+        decision.window = adaptive_stats.windows;
+        decision.from = placement_policy;
+        decision.to = next;
+        decision.failure_rate_before = failure_rate;
+        decision.fragmentation_before = fragmentation;
+
+        if (adaptive_stats.decisions.size() == max_adaptive_decisions) {
+            adaptive_stats.decisions.erase(adaptive_stats.decisions.begin());
+        }
+        adaptive_stats.decisions.push_back(decision);
+        adaptive_stats.switches++;
+        placement_policy = next;
+
+        global_logger->info(std::string("Adaptive placement switched to ") +
+                            (next == PlacementPolicy::best_fit ? "best fit" : "first fit"));
+    }
+
+    adaptive_window = {};
+}
+
+FixedSizeArrayTracker::AllocationDiagnostics FixedSizeArrayTracker::diagnose_allocation(unsigned int length) {
+    GlobalLogSection _("diagnose_allocation", log_mode);
+
+    // parked ranges would be coalesced by a failing search anyway, and they have to be for the gaps to be complete
+    flush_quick_lists();
+
+    unsigned int length_in_granules = reserved_granules_for(length);
+    unsigned int free_granules = granule_count - used_granules;
+
+    AllocationDiagnostics diagnostics;
+    diagnostics.requested_elements = length_in_granules * granule_size;
+    diagnostics.free_elements = free_granules * granule_size;
+    diagnostics.largest_free_block = get_largest_free_block();
+    diagnostics.gap_count = static_cast<unsigned int>(free_gaps.size());
+
+    if (diagnostics.largest_free_block >= diagnostics.requested_elements) {
+        diagnostics.reason = AllocationFailure::none;
+        return diagnostics;
+    }
+    diagnostics.reason =
+        free_granules >= length_in_granules ? AllocationFailure::fragmented : AllocationFailure::insufficient_space;
+
+    // every region above the first gap moves during compact(), that's the space above it minus the free space
+    if (diagnostics.reason == AllocationFailure::fragmented) {
+        unsigned int first_gap = free_gaps.begin()->first;
+        diagnostics.compact_move_elements = ((granule_count - first_gap) - free_granules) * granule_size;
+    }
+
+    // the candidate windows are bounded by free gaps, with the ends of the array acting as empty gaps
+    std::vector<std::pair<unsigned int, unsigned int>> bounds;
+    bounds.reserve(free_gaps.size() + 2);
+    if (free_gaps.empty() || free_gaps.begin()->first > 0) {
+        bounds.emplace_back(0, 0);
+    }
+    bounds.insert(bounds.end(), free_gaps.begin(), free_gaps.end());
+    if (free_gaps.empty() || free_gaps.rbegin()->second < granule_count) {
+        bounds.emplace_back(granule_count, granule_count);
+    }
+
+    // free_before[i] is the free space in the gaps before bounds[i]
+    std::vector<unsigned long long> free_before(bounds.size() + 1, 0);
+    for (std::size_t i = 0; i < bounds.size(); ++i) {
+        free_before[i + 1] = free_before[i] + (bounds[i].second - bounds[i].first);
+    }
+
+    // sliding the regions between gaps first..last down merges those gaps into one run at the top of the window.
+    // for a fixed first gap the cost only grows with last, so the cheapest window is found with two pointers
+    if (diagnostics.reason == AllocationFailure::fragmented) {
+        std::optional<unsigned long long> best_cost;
+        for (std::size_t first = 0, last = 0; first < bounds.size(); ++first) {
+            last = std::max(last, first);
+            while (last < bounds.size() && free_before[last + 1] - free_before[first] < length_in_granules) {
+                last++;
+            }
+            if (last == bounds.size()) {
+                break;
+            }
+            unsigned long long cost =
+                (bounds[last].first - bounds[first].first) - (free_before[last] - free_before[first]);
+            if (!best_cost || cost < *best_cost) {
+                best_cost = cost;
+                diagnostics.compaction_window = {bounds[first].first * granule_size,
+                                                 bounds[last].second * granule_size};
+                diagnostics.compaction_window_move_elements = static_cast<unsigned int>(cost * granule_size);
+            }
+        }
+    }
+
+    // evicting every region between gaps first..last frees the whole stretch from the start of the first to the end
+    // of the last, the cheapest such stretch that is long enough is again found with two pointers
+    if (length_in_granules <= granule_count) {
+        std::optional<unsigned long long> best_cost;
+        std::pair<unsigned int, unsigned int> best_window;
+        for (std::size_t first = 0, last = 0; first < bounds.size(); ++first) {
+            last = std::max(last, first);
+            while (last < bounds.size() && bounds[last].second - bounds[first].first < length_in_granules) {
+                last++;
+            }
+            if (last == bounds.size()) {
+                break;
+            }
+            unsigned long long cost =
+                (bounds[last].second - bounds[first].first) - (free_before[last + 1] - free_before[first]);
+            if (!best_cost || cost < *best_cost) {
+                best_cost = cost;
+                best_window = {bounds[first].first, bounds[last].second};
+            }
+        }
+
+        if (best_cost) {
+            diagnostics.eviction_window = {best_window.first * granule_size, best_window.second * granule_size};
+            diagnostics.eviction_elements = static_cast<unsigned int>(*best_cost * granule_size);
+            for (auto region = occupied_intervals.lower_bound(best_window.first);
+                 region != occupied_intervals.end() && (*region).start < best_window.second; ++region) {
+                diagnostics.eviction_ids.push_back((*region).id);
+            }
+        }
+    }
+
+    // like a search, the callbacks could make the diagnostics stale
+    check_watermarks(false);
+    return diagnostics;
+}
+
+bool FixedSizeArrayTracker::in_zone(unsigned int start, unsigned int length_in_granules, Lifetime lifetime) const {
+    unsigned int middle = granule_count / 2;
+    switch (lifetime) {
+    case Lifetime::transient:
+        return true;
+    case Lifetime::frame:
+        return static_cast<unsigned long long>(start) + length_in_granules <= middle;
+    default:
+        return start >= middle;
+    }
+}
+
+std::optional<unsigned int> FixedSizeArrayTracker::search_zone(unsigned int length_in_granules, Lifetime lifetime) {
+    unsigned int middle = granule_count / 2;
+
+    // each class grows from its own end of its half and only spills over once that is full
+    auto search = [this, length_in_granules, lifetime, middle]() -> std::optional<unsigned int> {
+        switch (lifetime) {
+        case Lifetime::frame: {
+            auto start = occupied_intervals.find_last_gap(length_in_granules, middle);
+            return start ? start : occupied_intervals.find_first_gap(length_in_granules);
+        }
+        case Lifetime::level: {
+            auto start = occupied_intervals.find_first_gap(length_in_granules, middle);
+            return start ? start : occupied_intervals.find_last_gap(length_in_granules);
+        }
+        default:
+            return occupied_intervals.find_last_gap(length_in_granules);
+        }
+    };
+
+    // the interval index also sees parked ranges as holes, once they are flushed its holes are exactly the gaps
+    auto start = search();
+    if (start && !is_free(*start, length_in_granules)) {
+        flush_quick_lists();
+        start = search();
+    }
+    return start;
+}
+
+std::optional<unsigned int> FixedSizeArrayTracker::allocate(int id, unsigned int length, Lifetime lifetime) {
+    GlobalLogSection _("allocate", log_mode);
+
+    if (id_in_use(id)) {
+        global_logger->info("ID '" + std::to_string(id) + "' already exists. Use a unique ID.");
+        return std::nullopt;
+    }
+
+    // every lifetime has its own segment, so the churn of the short lived ones doesn't punch holes between the
+    // long lived ones
+    auto start = find_space(length, lifetime);
+
+    region_lifetimes[id] = lifetime;
+    nested_operations++;
+    bool added = start && add_metadata(id, *start, length);
+    nested_operations--;
+
+    if (!added) {
+        region_lifetimes.erase(id);
+        global_logger->info("Error: No contiguous space for " + std::to_string(length) + " elements.");
+        check_watermarks();
+        return std::nullopt;
+    }
+
+    // the callbacks run now that the region is placed, and may move or remove it
+    check_watermarks();
+    auto placed = get_metadata(id);
+    return placed ? std::optional<unsigned int>(placed->first) : std::nullopt;
+}
+
+std::vector<std::uint64_t> FixedSizeArrayTracker::validate_placements(const unsigned int *starts,
+                                                                      const unsigned int *lengths, std::size_t count) {
+    GlobalLogSection _("validate_placements", log_mode);
+
+    if (quick_list_entries > 0) {
+        flush_quick_lists();
+    }
+
+    std::vector<std::uint64_t> rejected((count + 63) / 64, 0);
+    std::vector<unsigned int> granule_starts(count, 0);
+    std::vector<unsigned int> granule_ends(count, 0);
+    for (std::size_t i = 0; i < count; ++i) {
+        unsigned int start_granule = starts[i] / granule_size;
+        unsigned long long end_granule =
+            static_cast<unsigned long long>(start_granule) + reserved_granules_for(lengths[i]);
+        if (starts[i] % granule_size != 0 || end_granule > granule_count) {
+            // stays an empty interval at 0, which can't reject anything else
+            rejected[i / 64] |= std::uint64_t(1) << (i % 64);
+            continue;
+        }
+        granule_starts[i] = start_granule;
+        granule_ends[i] = static_cast<unsigned int>(end_granule);
+    }
 
-// returns a normalized value in [0, 1]
-double FixedSizeArrayTracker::get_usage_percentage() const {
-    unsigned int used_space = 0;
-    for (const auto &[id, range] : metadata) {
-        used_space += range.second;
+    BulkPlacementValidator validator;
+    validator.load(granule_starts.data(), granule_ends.data(), count);
+    validator.reject_overlaps(rejected);
+    validator.reject_outside(free_gaps, rejected);
+
+    // empty regions are never in the gap index, they only need to stay out of the inside of a region
+    for (unsigned int index : validator.get_empty_indices()) {
+        if (!is_free(granule_starts[index], 0)) {
+            rejected[index / 64] |= std::uint64_t(1) << (index % 64);
+        }
     }
-    return (static_cast<double>(used_space) / size);
+
+    return rejected;
 }
 
-// returns the index to the space with the contiguous space
-std::optional<unsigned int> FixedSizeArrayTracker::find_contiguous_space(unsigned int length) {
-    unsigned int last_end = 0;
+bool FixedSizeArrayTracker::assign_sorted(const std::vector<Placement> &placements) {
+    GlobalLogSection _("assign_sorted", log_mode);
+
+    // validate everything before touching any state, the new metadata doubles as the duplicate id check
+    std::unordered_map<int, std::pair<unsigned int, unsigned int>> new_metadata;
+    new_metadata.reserve(placements.size());
+    std::vector<IntervalBPlusTree::Entry> intervals;
+    intervals.reserve(placements.size());
+    unsigned int previous_start = 0;
+    unsigned int last_start_granule = 0;
+    unsigned int occupied_end = 0;
+
+    for (const auto &placement : placements) {
+        unsigned int start_granule = placement.start / granule_size;
+        unsigned long long end_granule =
+            static_cast<unsigned long long>(start_granule) + reserved_granules_for(placement.length);
+
+        // non-empty regions are disjoint, so the last one reaches furthest and is the only possible collision
+        bool collides = end_granule > start_granule
+                            ? start_granule < occupied_end
+                            : start_granule < occupied_end && start_granule != last_start_granule;
+
+        std::string error;
+        if (placement.start < previous_start) {
+            error = "Placements are not sorted by start.";
+        } else if (placement.start % granule_size != 0) {
+            error = "Metadata start is not aligned to the granule size.";
+        } else if (end_granule > granule_count) {
+            error = "Metadata exceeds array bounds.";
+        } else if (collides) {
+            error = "Metadata collides with an existing interval.";
+        } else if (!new_metadata.emplace(placement.id, std::make_pair(placement.start, placement.length)).second) {
+            error = "ID '" + std::to_string(placement.id) + "' is assigned twice.";
+        }
+        if (!error.empty()) {
+            global_logger->info("Error: " + error);
+            return false;
+        }
+
+        previous_start = placement.start;
+        if (end_granule > start_granule) {
+            intervals.push_back({start_granule, static_cast<unsigned int>(end_granule), placement.id});
+            last_start_granule = start_granule;
+            occupied_end = static_cast<unsigned int>(end_granule);
+        }
+    }
 
-    // iterate over intervals, and check if the gap size between intevals is large enough to store it
-    for (const auto &[start, end] : occupied_intervals) {
-        if (start - last_end >= length) {
-            return last_end; // Found space before this interval
+    // every id readers can look up now, the ones the new layout lacks are only erased once it is published
+    std::vector<int> published_ids;
+    if (concurrent_reads_enabled) {
+        published_ids.reserve(metadata.size());
+        for (const auto &[id, range] : metadata) {
+            published_ids.push_back(id);
+        }
+        for (const auto &[hash, ids] : shared_regions) {
+            published_ids.insert(published_ids.end(), ids.begin() + 1, ids.end());
         }
-        last_end = end;
     }
 
-    // check if there's enough space after the last interval
-    if (size - last_end >= length) {
-        return last_end;
+    // drop the old layout and everything keyed by its ids
+    ttl_wheel = HierarchicalTimerWheel(ttl_wheel.get_now());
+    shared_regions.clear();
+    content_hash_of_id.clear();
+    region_lifetimes.clear();
+    sampled_births.clear();
+    for (auto &lifetime : lifetime_intervals) {
+        lifetime.clear();
+    }
+    lifetime_used_granules.fill(0);
+    quick_lists.clear();
+    if (quick_list_entries > 0) {
+        quick_list_entries = 0;
+        quick_list_granules = 0;
+        quick_list_stats.flushes++;
     }
 
-    return std::nullopt;
+    metadata.swap(new_metadata);
+    used_elements = 0;
+    layout_fingerprint = 0;
+    for (const auto &[id, range] : metadata) {
+        used_elements += range.second;
+        layout_fingerprint += fingerprint_region(id, range.first, range.second);
+    }
+    // regions that stay are overwritten in place, so a reader never finds one of them missing
+    if (concurrent_reads_enabled) {
+        for (const auto &[id, range] : metadata) {
+            concurrent_metadata.store(id, range.first, range.second);
+        }
+        for (int id : published_ids) {
+            if (metadata.find(id) == metadata.end()) {
+                concurrent_metadata.erase(id);
+            }
+        }
+    }
+
+    // std::map and std::set are built in linear time from sorted input, the gaps come out sorted by start already
+    std::vector<std::pair<unsigned int, unsigned int>> gaps;
+    gaps.reserve(intervals.size() + 1);
+    used_granules = 0;
+    unsigned int gap_start = 0;
+    for (const auto &interval : intervals) {
+        if (gap_start < interval.start) {
+            gaps.emplace_back(gap_start, interval.start);
+        }
+        used_granules += interval.end - interval.start;
+        gap_start = interval.end;
+    }
+    if (gap_start < granule_count) {
+        gaps.emplace_back(gap_start, granule_count);
+    }
+
+    occupied_intervals.assign_sorted(intervals);
+    free_gaps = std::map<unsigned int, unsigned int>(gaps.begin(), gaps.end());
+    for (auto &gap : gaps) {
+        gap = {gap.second - gap.first, gap.first};
+    }
+    std::sort(gaps.begin(), gaps.end());
+    free_gaps_by_length = std::set<std::pair<unsigned int, unsigned int>>(gaps.begin(), gaps.end());
+    dirty_ranges.assign(1, {0, granule_count});
+
+    if (radix_regions) {
+        set_radix_index(true);
+    }
+    if (concurrent_intervals) {
+        publish_intervals();
+    }
+
+    global_logger->info("Assigned " + std::to_string(placements.size()) + " regions.");
+    check_watermarks();
+    return true;
 }
 
 bool FixedSizeArrayTracker::add_metadata(int id, unsigned int start, unsigned int length) {
+    if (--sample_countdown != 0) {
+        return add_metadata_unsampled(id, start, length);
+    }
+
+    std::uint64_t began = EventSampler::now();
+    bool added = add_metadata_unsampled(id, start, length);
+    event_sampler->record(added ? EventSampler::EventKind::allocation : EventSampler::EventKind::failed_allocation,
+                          id, start, length, began);
+    sample_countdown = event_sampler->next_interval();
+    return added;
+}
+
+bool FixedSizeArrayTracker::add_metadata_unsampled(int id, unsigned int start, unsigned int length) {
     GlobalLogSection _("add_metadata", log_mode);
 
-    if (metadata.count(id)) {
+    if (id_in_use(id)) {
         global_logger->info("ID '" + std::to_string(id) + "' already exists. Use a unique ID.");
+        counters.add(TrackerCounters::failed_additions);
         return false;
     }
 
-    if (start + length > size) {
+    if (start % granule_size != 0) {
+        global_logger->info("Error: Metadata start is not aligned to the granule size.");
+        counters.add(TrackerCounters::failed_additions);
+        return false;
+    }
+
+    unsigned int start_granule = start / granule_size;
+    unsigned int length_in_granules = reserved_granules_for(length);
+
+    if (static_cast<unsigned long long>(start_granule) + length_in_granules > granule_count) {
         global_logger->info("Error: Metadata exceeds array bounds.");
+        counters.add(TrackerCounters::failed_additions);
         return false;
     }
 
-    // TODO: could be more efficient
-    for (const auto &interval : occupied_intervals) {
-        if (!(start + length <= interval.first || start >= interval.second)) {
+    // a range handed out from a quick list is taken back off the top of that list
+    auto quick_list = quick_lists.find(length_in_granules);
+    bool from_quick_list = quick_list != quick_lists.end() && !quick_list->second.empty() &&
+                           quick_list->second.back() == start_granule;
+
+    if (from_quick_list) {
+        quick_list->second.pop_back();
+        quick_list_entries--;
+        quick_list_granules -= length_in_granules;
+    } else {
+        // parked ranges are invisible to the gap index, so coalesce them before deciding there is a collision
+        if (!is_free(start_granule, length_in_granules) && quick_list_entries > 0) {
+            flush_quick_lists();
+        }
+        if (!is_free(start_granule, length_in_granules)) {
             global_logger->info("Error: Metadata collides with an existing interval.");
+            counters.add(TrackerCounters::failed_additions);
             return false;
         }
     }
 
     // Add metadata and update occupied intervals
-    metadata[id] = {start, length};
-    occupied_intervals.insert({start, start + length});
+    if (!from_quick_list) {
+        occupy_granules(start_granule, length_in_granules);
+    }
+    index_region(id, start, length, length_in_granules);
+    counters.add(TrackerCounters::additions);
+
+    if (profiling_enabled) {
+        allocation_profile.record_placement(length, static_cast<unsigned int>(metadata.size()));
+    }
+
+    if (adaptive_policy_enabled && adaptive_clock++ % adaptive_lifetime_sample_rate == 0) {
+        sampled_births[id] = adaptive_clock;
+    }
 
     global_logger->info("Added metadata: ID=" + std::to_string(id) + ", start=" + std::to_string(start) +
                         ", length=" + std::to_string(length));
 
+    check_watermarks();
     return true;
 }
 
+unsigned int FixedSizeArrayTracker::drop_region(int id) {
+    unsigned int length_in_granules = unindex_region(id);
+    if (concurrent_reads_enabled) {
+        concurrent_metadata.erase(id);
+    }
+    region_lifetimes.erase(id);
+    ttl_wheel.cancel(id);
+
+    auto birth = sampled_births.find(id);
+    if (birth != sampled_births.end()) {
+        adaptive_window.lifetime_sum += static_cast<double>(adaptive_clock - birth->second);
+        adaptive_window.lifetime_samples++;
+        sampled_births.erase(birth);
+    }
+
+    return length_in_granules;
+}
+
+bool FixedSizeArrayTracker::id_in_use(int id) const { return metadata.count(id) || content_hash_of_id.count(id); }
+
+bool FixedSizeArrayTracker::is_shared(int id) const { return content_hash_of_id.count(id) != 0; }
+
+std::optional<unsigned int> FixedSizeArrayTracker::allocate_shared(int id, unsigned int length,
+                                                                   std::uint64_t content_hash, Lifetime lifetime) {
+    GlobalLogSection _("allocate_shared", log_mode);
+
+    if (id_in_use(id)) {
+        global_logger->info("ID '" + std::to_string(id) + "' already exists. Use a unique ID.");
+        return std::nullopt;
+    }
+
+    auto shared = shared_regions.find(content_hash);
+    if (shared != shared_regions.end()) {
+        const auto &range = metadata.at(shared->second.front());
+        if (range.second != length) {
+            global_logger->info("Error: Content hash matches a region of a different length.");
+            return std::nullopt;
+        }
+        shared->second.push_back(id);
+        content_hash_of_id[id] = content_hash;
+        if (concurrent_reads_enabled) {
+            concurrent_metadata.store(id, range.first, range.second);
+        }
+        global_logger->info("ID=" + std::to_string(id) + " shares the region of ID=" +
+                            std::to_string(shared->second.front()));
+        return range.first;
+    }
+
+    // the region has to be registered as shared before a callback can see it
+    nested_operations++;
+    auto start = allocate(id, length, lifetime);
+    if (start) {
+        shared_regions[content_hash] = {id};
+        content_hash_of_id[id] = content_hash;
+    }
+    nested_operations--;
+
+    check_watermarks();
+    auto placed = start ? get_metadata(id) : std::nullopt;
+    return placed ? std::optional<unsigned int>(placed->first) : std::nullopt;
+}
+
+unsigned int FixedSizeArrayTracker::get_reference_count(int id) const {
+    auto hash = content_hash_of_id.find(id);
+    if (hash != content_hash_of_id.end()) {
+        return static_cast<unsigned int>(shared_regions.at(hash->second).size());
+    }
+    return metadata.count(id) ? 1 : 0;
+}
+
+bool FixedSizeArrayTracker::release_reference(int id) {
+    auto hash = content_hash_of_id.find(id);
+    if (hash == content_hash_of_id.end()) {
+        return true;
+    }
+
+    auto shared = shared_regions.find(hash->second);
+    std::vector<int> &ids = shared->second;
+    content_hash_of_id.erase(hash);
+
+    if (ids.size() == 1) {
+        shared_regions.erase(shared);
+        return true;
+    }
+
+    bool is_owner = ids.front() == id;
+    ids.erase(std::find(ids.begin(), ids.end(), id));
+    if (concurrent_reads_enabled) {
+        concurrent_metadata.erase(id);
+    }
+
+    // the region outlives its owner, so it's handed over to the next alias without moving
+    if (is_owner) {
+        int new_owner = ids.front();
+        auto [start, length] = metadata.at(id);
+        auto lifetime = region_lifetimes.find(id);
+        if (lifetime != region_lifetimes.end()) {
+            region_lifetimes[new_owner] = lifetime->second;
+        }
+        index_region(new_owner, start, length, drop_region(id));
+    }
+
+    global_logger->info("Released a reference to the region shared by ID=" + std::to_string(id));
+    return false;
+}
+
 void FixedSizeArrayTracker::remove_metadata(int id) {
+    if (--sample_countdown != 0) {
+        remove_metadata_unsampled(id);
+        return;
+    }
+
+    // the range is looked up before it's gone, unknown ids remove nothing and aren't recorded
+    auto range = get_metadata(id);
+    std::uint64_t began = EventSampler::now();
+    remove_metadata_unsampled(id);
+    if (range) {
+        event_sampler->record(EventSampler::EventKind::free, id, range->first, range->second, began);
+    }
+    sample_countdown = event_sampler->next_interval();
+}
+
+void FixedSizeArrayTracker::remove_metadata_unsampled(int id) {
     GlobalLogSection _("remove_metadata", log_mode);
+
+    if (id_in_use(id)) {
+        counters.add(TrackerCounters::removals);
+    }
+
+    // a shared region is only freed with its last reference
+    if (!release_reference(id)) {
+        return;
+    }
+
     auto it = metadata.find(id);
     if (it != metadata.end()) {
         // Remove metadata and update intervals
-        auto &[start, length] = it->second;
-        occupied_intervals.erase({start, start + length});
-        metadata.erase(it);
+        unsigned int start_granule = it->second.first / granule_size;
+        unsigned int length_in_granules = drop_region(id);
+
+        if (quick_list_limit > 0 && length_in_granules > 0) {
+            // park the range for an exact-size reuse, coalescing waits until the lists overflow
+            quick_lists[length_in_granules].push_back(start_granule);
+            quick_list_granules += length_in_granules;
+            if (++quick_list_entries > quick_list_limit) {
+                flush_quick_lists();
+            }
+        } else {
+            release_granules(start_granule, length_in_granules);
+        }
 
         global_logger->info("Removed metadata for ID=" + std::to_string(id));
+        check_watermarks();
     } else {
         global_logger->info("ID '" + std::to_string(id) + "' not found.");
     }
 }
 
+bool FixedSizeArrayTracker::set_ttl(int id, unsigned long long expires_at) {
+    if (!metadata.count(id) || is_shared(id)) {
+        global_logger->info("Error: ID '" + std::to_string(id) + "' not found or shared.");
+        return false;
+    }
+    ttl_wheel.schedule(id, expires_at);
+    return true;
+}
+
+bool FixedSizeArrayTracker::clear_ttl(int id) { return ttl_wheel.cancel(id); }
+
+std::optional<unsigned long long> FixedSizeArrayTracker::get_ttl(int id) const { return ttl_wheel.get_deadline(id); }
+
+std::vector<int> FixedSizeArrayTracker::advance(unsigned long long now) {
+    GlobalLogSection _("advance", log_mode);
+
+    std::vector<int> expired = ttl_wheel.advance(now);
+    if (expired.empty()) {
+        return expired;
+    }
+    counters.add(TrackerCounters::expirations, expired.size());
+
+    // drop the regions first and return their space in one address ordered pass, so neighbouring expired regions
+    // are joined before they reach the gap index instead of being coalesced one at a time
+    std::vector<std::pair<unsigned int, unsigned int>> freed;
+    freed.reserve(expired.size());
+    for (int id : expired) {
+        unsigned int start_granule = metadata.at(id).first / granule_size;
+        freed.emplace_back(start_granule, start_granule + drop_region(id));
+    }
+    std::sort(freed.begin(), freed.end());
+
+    std::size_t i = 0;
+    while (i < freed.size()) {
+        unsigned int start = freed[i].first;
+        unsigned int end = freed[i].second;
+        for (++i; i < freed.size() && freed[i].first == end; ++i) {
+            end = freed[i].second;
+        }
+        release_granules(start, end - start);
+    }
+
+    global_logger->info("Expired " + std::to_string(expired.size()) + " regions.");
+    check_watermarks();
+    return expired;
+}
+
+bool FixedSizeArrayTracker::split(int id, unsigned int offset, int new_id) {
+    GlobalLogSection _("split", log_mode);
+
+    auto it = metadata.find(id);
+    if (it == metadata.end() || is_shared(id)) {
+        global_logger->info("Error: ID '" + std::to_string(id) + "' not found or shared.");
+        return false;
+    }
+
+    if (id_in_use(new_id)) {
+        global_logger->info("ID '" + std::to_string(new_id) + "' already exists. Use a unique ID.");
+        return false;
+    }
+
+    auto [start, length] = it->second;
+    if (offset == 0 || offset >= length || offset % granule_size != 0) {
+        global_logger->info("Error: Split offset must be a granule aligned position inside the region.");
+        return false;
+    }
+
+    // the split point is on a granule boundary, so the two halves cover exactly the granules of the original and
+    // the gap index doesn't change
+    unsigned int length_in_granules = unindex_region(id);
+    unsigned int offset_in_granules = offset / granule_size;
+    index_region(id, start, offset, offset_in_granules);
+
+    auto lifetime = region_lifetimes.find(id);
+    if (lifetime != region_lifetimes.end()) {
+        region_lifetimes[new_id] = lifetime->second;
+    }
+    index_region(new_id, start + offset, length - offset, length_in_granules - offset_in_granules);
+
+    global_logger->info("Split ID=" + std::to_string(id) + " at offset=" + std::to_string(offset) +
+                        " into new ID=" + std::to_string(new_id));
+    publish_counters();
+    return true;
+}
+
+bool FixedSizeArrayTracker::merge(int id_a, int id_b) {
+    GlobalLogSection _("merge", log_mode);
+
+    auto it_a = metadata.find(id_a);
+    auto it_b = metadata.find(id_b);
+    if (id_a == id_b || it_a == metadata.end() || it_b == metadata.end() || is_shared(id_a) || is_shared(id_b)) {
+        global_logger->info("Error: Merge requires two distinct existing IDs that aren't shared.");
+        return false;
+    }
+
+    auto [start_a, length_a] = it_a->second;
+    auto [start_b, length_b] = it_b->second;
+
+    // order the two regions by address, the lower one has to end exactly where the upper one starts
+    bool a_first = start_a < start_b;
+    unsigned int low_start = a_first ? start_a : start_b;
+    unsigned int low_length = a_first ? length_a : length_b;
+    unsigned int high_start = a_first ? start_b : start_a;
+    unsigned int high_length = a_first ? length_b : length_a;
+
+    // the lower region also has to fill every granule it reserved, otherwise the data wouldn't be contiguous
+    if (low_start + low_length != high_start || low_length % granule_size != 0 ||
+        reserved_granules_of(low_start, low_length) != low_length / granule_size) {
+        global_logger->info("Error: Only adjacent regions can be merged.");
+        return false;
+    }
+
+    // the combined region covers exactly the granules of both, so the gap index doesn't change. id_b goes away
+    // like a removed region, with its ttl, lifetime and sampled birth
+    unsigned int length_in_granules = drop_region(id_b) + unindex_region(id_a);
+    index_region(id_a, low_start, low_length + high_length, length_in_granules);
+
+    global_logger->info("Merged ID=" + std::to_string(id_b) + " into ID=" + std::to_string(id_a));
+    publish_counters();
+    return true;
+}
+
+bool FixedSizeArrayTracker::trim_front(int id, unsigned int n) {
+    GlobalLogSection _("trim_front", log_mode);
+
+    auto it = metadata.find(id);
+    if (it == metadata.end() || is_shared(id)) {
+        global_logger->info("Error: ID '" + std::to_string(id) + "' not found or shared.");
+        return false;
+    }
+
+    auto [start, length] = it->second;
+    if (n >= length || n % granule_size != 0) {
+        global_logger->info("Error: trim_front needs a granule aligned count smaller than the region.");
+        return false;
+    }
+
+    if (n == 0) {
+        return true;
+    }
+
+    unsigned int length_in_granules = unindex_region(id);
+    release_granules(start / granule_size, n / granule_size);
+    index_region(id, start + n, length - n, length_in_granules - n / granule_size);
+
+    global_logger->info("Trimmed " + std::to_string(n) + " elements from the front of ID=" + std::to_string(id));
+    check_watermarks();
+    return true;
+}
+
+bool FixedSizeArrayTracker::trim_back(int id, unsigned int n) {
+    GlobalLogSection _("trim_back", log_mode);
+
+    auto it = metadata.find(id);
+    if (it == metadata.end() || is_shared(id)) {
+        global_logger->info("Error: ID '" + std::to_string(id) + "' not found or shared.");
+        return false;
+    }
+
+    auto [start, length] = it->second;
+    if (n >= length) {
+        global_logger->info("Error: trim_back needs a count smaller than the region.");
+        return false;
+    }
+
+    // the region keeps only the granules its new length touches, the last one may still be partially used
+    unsigned int start_granule = start / granule_size;
+    unsigned int old_length_in_granules = unindex_region(id);
+    unsigned int new_length_in_granules = std::min(old_length_in_granules, granules_for(length - n));
+    release_granules(start_granule + new_length_in_granules, old_length_in_granules - new_length_in_granules);
+    index_region(id, start, length - n, new_length_in_granules);
+
+    global_logger->info("Trimmed " + std::to_string(n) + " elements from the back of ID=" + std::to_string(id));
+    check_watermarks();
+    return true;
+}
+
 std::optional<std::pair<unsigned int, unsigned int>> FixedSizeArrayTracker::get_metadata(int id) const {
     auto it = metadata.find(id);
     if (it != metadata.end()) {
         return it->second;
     }
+
+    // aliases of a shared region resolve to the id that owns it
+    auto hash = content_hash_of_id.find(id);
+    if (hash != content_hash_of_id.end()) {
+        return metadata.at(shared_regions.at(hash->second).front());
+    }
     return std::nullopt;
 }
 
+std::optional<int> FixedSizeArrayTracker::get_owner(unsigned int position) const {
+    unsigned int granule = position / granule_size;
+    if (granule >= granule_count) {
+        return std::nullopt;
+    }
+
+    // the owner is the last region starting at or before the granule, if it reaches past it
+    if (radix_regions) {
+        auto start = radix_regions->predecessor(granule);
+        if (!start) {
+            return std::nullopt;
+        }
+        auto region = *radix_regions->find(*start);
+        return region.end > granule ? std::optional<int>(region.id) : std::nullopt;
+    }
+
+    auto next = occupied_intervals.lower_bound(granule + 1);
+    if (next == occupied_intervals.begin()) {
+        return std::nullopt;
+    }
+    auto region = *--next;
+    return region.end > granule ? std::optional<int>(region.id) : std::nullopt;
+}
+
+void FixedSizeArrayTracker::set_radix_index(bool enabled) {
+    radix_regions.reset();
+    radix_gaps.reset();
+    if (!enabled) {
+        return;
+    }
+
+    radix_regions.emplace(granule_count);
+    radix_gaps.emplace(granule_count);
+    for (auto region = occupied_intervals.begin(); region != occupied_intervals.end(); ++region) {
+        radix_regions->insert((*region).start, (*region).end, (*region).id);
+    }
+    for (const auto &[start, end] : free_gaps) {
+        radix_gaps->insert(start, end);
+    }
+}
+
+FixedSizeArrayTracker::IndexMemory FixedSizeArrayTracker::get_index_memory() const {
+    IndexMemory memory;
+    memory.interval_index_bytes = occupied_intervals.memory_bytes();
+    if (radix_regions) {
+        memory.radix_index_bytes = radix_regions->memory_bytes() + radix_gaps->memory_bytes();
+    }
+    return memory;
+}
+
+FixedSizeArrayTracker::OperationStats FixedSizeArrayTracker::get_operation_stats() const {
+    OperationStats stats;
+    stats.searches = counters.get(TrackerCounters::searches);
+    stats.failed_searches = counters.get(TrackerCounters::failed_searches);
+    stats.additions = counters.get(TrackerCounters::additions);
+    stats.failed_additions = counters.get(TrackerCounters::failed_additions);
+    stats.removals = counters.get(TrackerCounters::removals);
+    stats.expirations = counters.get(TrackerCounters::expirations);
+    stats.compactions = counters.get(TrackerCounters::compactions);
+    return stats;
+}
+
+const TrackerCounters &FixedSizeArrayTracker::get_counters() const { return counters; }
+
+void FixedSizeArrayTracker::publish_counters() {
+    counters.set(TrackerCounters::regions, metadata.size());
+    counters.set(TrackerCounters::total_elements, size);
+    counters.set(TrackerCounters::used_elements, used_elements);
+    counters.set(TrackerCounters::reserved_elements, static_cast<std::uint64_t>(used_granules) * granule_size);
+    counters.set(TrackerCounters::free_elements,
+                 static_cast<std::uint64_t>(granule_count - used_granules) * granule_size);
+    counters.set(TrackerCounters::largest_free_block, get_largest_free_block());
+}
+
+FixedSizeArrayTracker::MemoryFootprint FixedSizeArrayTracker::memory_footprint() const {
+    MemoryFootprint footprint;
+    footprint.object_bytes = sizeof(*this);
+    footprint.metadata_bytes = hashed_container_bytes(metadata) + concurrent_metadata.memory_bytes();
+
+    footprint.interval_index_bytes = occupied_intervals.memory_bytes();
+    footprint.gap_index_bytes = ordered_container_bytes(free_gaps) + ordered_container_bytes(free_gaps_by_length);
+    if (radix_regions) {
+        footprint.interval_index_bytes += radix_regions->memory_bytes();
+        footprint.gap_index_bytes += radix_gaps->memory_bytes();
+    }
+    if (concurrent_intervals) {
+        footprint.interval_index_bytes += concurrent_intervals->memory_bytes();
+    }
+
+    std::size_t auxiliary = hashed_container_bytes(quick_lists);
+    for (const auto &[length, starts] : quick_lists) {
+        auxiliary += vector_bytes(starts);
+    }
+    auxiliary += hashed_container_bytes(shared_regions) + hashed_container_bytes(content_hash_of_id);
+    for (const auto &[hash, ids] : shared_regions) {
+        auxiliary += vector_bytes(ids);
+    }
+    auxiliary += hashed_container_bytes(region_lifetimes);
+    for (const auto &intervals : lifetime_intervals) {
+        auxiliary += ordered_container_bytes(intervals);
+    }
+    auxiliary += ttl_wheel.memory_bytes() + allocation_profile.memory_bytes() +
+                 vector_bytes(size_classes.get_class_sizes()) + hashed_container_bytes(sampled_births) +
+                 vector_bytes(adaptive_stats.decisions) + vector_bytes(dirty_ranges);
+    footprint.auxiliary_bytes = auxiliary;
+
+    footprint.total_bytes = footprint.object_bytes + footprint.metadata_bytes + footprint.interval_index_bytes +
+                            footprint.gap_index_bytes + footprint.auxiliary_bytes;
+    return footprint;
+}
+
+void FixedSizeArrayTracker::publish_region(int id, unsigned int start, unsigned int length) {
+    if (!concurrent_reads_enabled) {
+        return;
+    }
+
+    // ranges are updated in place, so a reader sees either the old or the new range of a region but never neither
+    concurrent_metadata.store(id, start, length);
+    auto hash = content_hash_of_id.find(id);
+    if (hash != content_hash_of_id.end()) {
+        for (int alias : shared_regions.at(hash->second)) {
+            concurrent_metadata.store(alias, start, length);
+        }
+    }
+}
+
+void FixedSizeArrayTracker::set_concurrent_reads(bool enabled) {
+    // turning it on again would clear the table under readers that are using it
+    if (enabled == concurrent_reads_enabled) {
+        return;
+    }
+
+    concurrent_metadata.clear();
+    concurrent_reads_enabled = enabled;
+    if (!enabled) {
+        return;
+    }
+
+    for (const auto &[id, range] : metadata) {
+        publish_region(id, range.first, range.second);
+    }
+}
+
+std::optional<std::pair<unsigned int, unsigned int>> FixedSizeArrayTracker::get_metadata_concurrent(int id) const {
+    return concurrent_metadata.load(id);
+}
+
+void FixedSizeArrayTracker::set_concurrent_search(bool enabled) {
+    if (enabled == concurrent_intervals.has_value()) {
+        return;
+    }
+
+    concurrent_intervals.reset();
+    if (enabled) {
+        concurrent_intervals.emplace(granule_count);
+        publish_intervals();
+    }
+}
+
+void FixedSizeArrayTracker::publish_intervals() {
+    std::vector<ConcurrentIntervalSkipList::Entry> entries;
+    entries.reserve(occupied_intervals.size());
+    for (auto region = occupied_intervals.begin(); region != occupied_intervals.end(); ++region) {
+        entries.push_back({(*region).start, (*region).end, (*region).id});
+    }
+    concurrent_intervals->assign_sorted(entries);
+}
+
+std::optional<unsigned int> FixedSizeArrayTracker::find_contiguous_space_concurrent(unsigned int length) const {
+    if (!concurrent_intervals) {
+        return std::nullopt;
+    }
+
+    // size classes may change under the call, granule_size never does
+    unsigned int length_in_granules = granules_for(length);
+    // empty regions fit anywhere, as in find_contiguous_space
+    if (length_in_granules == 0) {
+        return 0;
+    }
+
+    auto start = concurrent_intervals->find_free(length_in_granules);
+    if (!start) {
+        return std::nullopt;
+    }
+    return *start * granule_size;
+}
+
 void FixedSizeArrayTracker::compact() {
     GlobalLogSection _("compact", log_mode);
     unsigned int current_index = 0;
-    std::unordered_map<int, std::pair<unsigned int, unsigned int>> new_metadata;
-
-    // reassign contiguously at the start to eliminate gaps
+    struct Region {
+        int id;
+        unsigned int length;
+        unsigned int length_in_granules;
+    };
+    std::vector<Region> regions;
+    regions.reserve(metadata.size());
+    // walk the regions in address order so they keep their relative order, diagnose_allocation relies on it
+    for (auto region = occupied_intervals.begin(); region != occupied_intervals.end(); ++region) {
+        regions.push_back({(*region).id, metadata.at((*region).id).second, (*region).end - (*region).start});
+    }
+    // empty regions have no interval, they end up where the packed regions stop
     for (const auto &[id, range] : metadata) {
-        unsigned int length = range.second;
-        new_metadata[id] = {current_index, length};
-        current_index += length;
+        if (reserved_granules_of(range.first, range.second) == 0) {
+            regions.push_back({id, range.second, 0});
+        }
     }
 
-    metadata = std::move(new_metadata); // move the new metadata
-    occupied_intervals.clear();         // clear the current intervals
-    for (const auto &[id, range] : metadata) {
-        unsigned int start = range.first;
-        unsigned int length = range.second;
-        occupied_intervals.insert({start, start + length});
+    // drop every region index and rebuild them from scratch below
+    metadata.clear();
+    occupied_intervals.clear();
+    if (radix_regions) {
+        radix_regions->clear();
+    }
+    // readers keep searching the old layout until the packed one is published below
+    mirror_intervals = false;
+    dirty_ranges.assign(1, {0, granule_count});
+    for (auto &intervals : lifetime_intervals) {
+        intervals.clear();
+    }
+    lifetime_used_granules.fill(0);
+    used_elements = 0;
+    used_granules = 0;
+    layout_fingerprint = 0;
+
+    // parked ranges are swallowed by the single trailing gap built below
+    quick_lists.clear();
+    if (quick_list_entries > 0) {
+        quick_list_entries = 0;
+        quick_list_granules = 0;
+        quick_list_stats.flushes++;
+    }
+
+    // reassign contiguously at the start to eliminate gaps, current_index counts granules
+    for (const auto &region : regions) {
+        index_region(region.id, current_index * granule_size, region.length, region.length_in_granules);
+        current_index += region.length_in_granules;
+    }
+
+    // everything is packed at the front now, so a single gap remains at the end
+    free_gaps.clear();
+    free_gaps_by_length.clear();
+    if (radix_gaps) {
+        radix_gaps->clear();
+    }
+    if (current_index < granule_count) {
+        insert_gap(current_index, granule_count);
+    }
+    mirror_intervals = true;
+    if (concurrent_intervals) {
+        publish_intervals();
     }
 
+    counters.add(TrackerCounters::compactions);
     global_logger->info("Compacted metadata.");
+    check_watermarks();
 }
 
 const std::unordered_map<int, std::pair<unsigned int, unsigned int>> &FixedSizeArrayTracker::get_all_metadata() const {
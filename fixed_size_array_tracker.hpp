@@ -1,12 +1,27 @@
 #ifndef FIXED_SIZE_ARRAY_TRACKER_HPP
 #define FIXED_SIZE_ARRAY_TRACKER_HPP
 
+#include <array>
+#include <cstdint>
 #include <unordered_map>
+#include <map>
 #include <set>
 #include <optional>
+#include <functional>
+#include <vector>
 #include <iostream>
+#include <limits>
 
 #include "sbpt_generated_includes.hpp"
+#include "allocation_profile.hpp"
+#include "timer_wheel.hpp"
+#include "seqlock_metadata_table.hpp"
+#include "concurrent_interval_skip_list.hpp"
+#include "interval_bplus_tree.hpp"
+#include "radix_interval_index.hpp"
+#include "bulk_placement_validator.hpp"
+#include "tracker_counters.hpp"
+#include "event_sampler.hpp"
 
 /**
  * @class FixedSizeArrayTracker
@@ -18,12 +33,208 @@
  */
 class FixedSizeArrayTracker {
   public:
+    /**
+     * @brief A snapshot of how the tracked array is being used.
+     *
+     * Regions are placed on granule boundaries and occupy a whole number of granules, so the
+     * space reserved for a region can exceed the length that was requested for it. That
+     * difference is reported separately as rounding waste.
+     */
+    struct UsageStats {
+        /// the total size of the tracked array in elements.
+        unsigned int total_elements = 0;
+        /// the sum of the lengths requested by all regions.
+        unsigned int used_elements = 0;
+        /// the space actually reserved by all regions, rounded up to whole granules.
+        unsigned int reserved_elements = 0;
+        /// reserved_elements - used_elements.
+        unsigned int rounding_waste = 0;
+        /// trailing elements that don't fill a whole granule and can never be allocated.
+        unsigned int unusable_tail = 0;
+    };
+
+    /**
+     * @brief How long a region is expected to live, used to keep regions of similar lifetimes together.
+     */
+    enum class Lifetime { transient, frame, level, permanent };
+
+    /**
+     * @brief Placement statistics for all regions allocated with one Lifetime.
+     */
+    struct LifetimeStats {
+        /// the number of live regions of this lifetime.
+        unsigned int regions = 0;
+        /// the space reserved by those regions, in elements.
+        unsigned int reserved_elements = 0;
+        /// the distance from the start of the lowest to the end of the highest of those regions, in elements.
+        unsigned int span_elements = 0;
+        /// the fraction of the span not used by this lifetime, 0 means its regions are packed together.
+        double fragmentation = 0.0;
+    };
+
+    /**
+     * @brief How the general gap search picks among the gaps a region fits in.
+     */
+    enum class PlacementPolicy {
+        /// the lowest addressed gap, keeps regions packed towards the start of the array.
+        first_fit,
+        /// the smallest gap, leaves large gaps intact for large requests.
+        best_fit
+    };
+
+    /**
+     * @brief A policy switch made by the adaptive mode and what it did.
+     */
+    struct AdaptiveDecision {
+        /// the index of the observation window that triggered the switch.
+        unsigned long long window = 0;
+        PlacementPolicy from = PlacementPolicy::first_fit;
+        PlacementPolicy to = PlacementPolicy::first_fit;
+        /// the workload measured in the window that triggered the switch.
+        double failure_rate_before = 0.0;
+        double fragmentation_before = 0.0;
+        /// the workload measured in the window after the switch, valid once measured is true.
+        double failure_rate_after = 0.0;
+        double fragmentation_after = 0.0;
+        bool measured = false;
+    };
+
+    /**
+     * @brief What the adaptive mode observed in its last window and which decisions it made.
+     */
+    struct AdaptiveStats {
+        /// the number of completed observation windows.
+        unsigned long long windows = 0;
+        unsigned long long switches = 0;
+        /// the fraction of searches in the last window that found no space.
+        double failure_rate = 0.0;
+        /// get_fragmentation() at the end of the last window.
+        double fragmentation = 0.0;
+        /// the coefficient of variation of the requested lengths in the last window.
+        double size_variation = 0.0;
+        /// the mean lifetime of the sampled regions freed in the last window, measured in add_metadata calls.
+        double mean_lifetime = 0.0;
+        /// the most recent policy switches, oldest first.
+        std::vector<AdaptiveDecision> decisions;
+    };
+
+    /**
+     * @brief The quantities watermarks can be placed on.
+     */
+    enum class WatermarkMetric {
+        /// get_usage_percentage(), in [0, 1].
+        usage,
+        /// get_largest_free_block(), in elements.
+        largest_free_block
+    };
+
+    enum class WatermarkCrossing { above_high, below_low };
+
+    /**
+     * @brief Called with the metric, the direction it crossed in and its new value.
+     *
+     * The callback may mutate the tracker, for example to compact it or remove regions.
+     */
+    using WatermarkCallback = std::function<void(WatermarkMetric, WatermarkCrossing, double)>;
+
+    /**
+     * @brief What one bit of an occupancy bitset stands for.
+     */
+    enum class OccupancyUnit {
+        /// a granule, set if it is reserved by a region.
+        granule,
+        /// an element, set if it lies inside a region's requested length.
+        element
+    };
+
+    enum class AllocationFailure {
+        /// the request fits.
+        none,
+        /// there is less free space in total than requested, something has to be freed.
+        insufficient_space,
+        /// there is enough free space but no single gap is large enough, compacting would help.
+        fragmented
+    };
+
+    /**
+     * @brief Why a request does or doesn't fit and what it would take to make it fit.
+     *
+     * All positions and sizes are in elements. Windows are half open ranges [first, second).
+     */
+    struct AllocationDiagnostics {
+        AllocationFailure reason = AllocationFailure::none;
+        /// the request after rounding up to its size class and whole granules.
+        unsigned int requested_elements = 0;
+        unsigned int free_elements = 0;
+        unsigned int largest_free_block = 0;
+        /// the number of separate free gaps.
+        unsigned int gap_count = 0;
+        /// how many elements compact() would move, set when the reason is fragmented.
+        unsigned int compact_move_elements = 0;
+        /// the cheapest stretch whose regions can be slid together to open a large enough gap inside it, set when
+        /// the reason is fragmented.
+        std::optional<std::pair<unsigned int, unsigned int>> compaction_window;
+        /// how many elements sliding the regions in compaction_window would move.
+        unsigned int compaction_window_move_elements = 0;
+        /// the cheapest stretch bounded by free gaps or the ends of the array that is large enough once every region
+        /// in it is removed, set unless the request is larger than the array.
+        std::optional<std::pair<unsigned int, unsigned int>> eviction_window;
+        /// the elements reserved by the regions in eviction_window.
+        unsigned int eviction_elements = 0;
+        /// the ids of the regions in eviction_window, in address order.
+        std::vector<int> eviction_ids;
+    };
+
+    /**
+     * @brief Counters describing how well the exact-size quick lists are doing.
+     */
+    struct QuickListStats {
+        /// searches that were served straight from a quick list.
+        unsigned long long hits = 0;
+        /// searches that had to fall back to the gap index.
+        unsigned long long misses = 0;
+        /// how many times the quick lists were drained back into the gap index.
+        unsigned long long flushes = 0;
+
+        /// hits / (hits + misses), or 0 if nothing has been searched yet.
+        double hit_rate() const;
+    };
+
+    /**
+     * @brief Running counts of the operations a tracker has served since it was constructed.
+     */
+    struct OperationStats {
+        /// calls to find_contiguous_space, including the ones made by allocate.
+        unsigned long long searches = 0;
+        unsigned long long failed_searches = 0;
+        /// regions added by add_metadata, including the ones placed by allocate.
+        unsigned long long additions = 0;
+        /// add_metadata calls that were refused.
+        unsigned long long failed_additions = 0;
+        /// remove_metadata calls for known ids.
+        unsigned long long removals = 0;
+        /// regions removed by advance because their TTL ran out.
+        unsigned long long expirations = 0;
+        unsigned long long compactions = 0;
+    };
+
     /**
      * @brief Constructs a FixedSizeArrayTracker with a specified array size.
      * @param size The total size of the array to track.
      * @param logging_enabled If true, enables debug logging to standard output.
+     * @param granule_size The allocation unit in elements. Every region starts on a multiple of this value and
+     * occupies a whole number of granules, and all internal indexes count granules instead of elements.
      */
-    FixedSizeArrayTracker(unsigned int size, LogSection::LogMode log_mode = LogSection::LogMode::disable);
+    FixedSizeArrayTracker(unsigned int size, LogSection::LogMode log_mode = LogSection::LogMode::disable,
+                          unsigned int granule_size = 1);
+
+    FixedSizeArrayTracker(const FixedSizeArrayTracker &other) = default;
+    FixedSizeArrayTracker(FixedSizeArrayTracker &&other) = default;
+    FixedSizeArrayTracker &operator=(const FixedSizeArrayTracker &other) = default;
+    FixedSizeArrayTracker &operator=(FixedSizeArrayTracker &&other) = default;
+
+    /// leaves the TrackerRegistry if it was added to it.
+    ~FixedSizeArrayTracker();
 
     /**
      * @brief Logs a message to the console if logging is enabled.
@@ -37,28 +248,332 @@ class FixedSizeArrayTracker {
      */
     double get_usage_percentage() const;
 
+    /**
+     * @brief The length of the largest run of free elements that can be allocated without flushing the quick lists.
+     */
+    unsigned int get_largest_free_block() const;
+
+    /**
+     * @brief Calls back when usage rises to high or falls to low.
+     *
+     * Each side fires once when it is entered and is re-armed only after the other side has been reached, so a value
+     * hovering around one watermark doesn't fire repeatedly. Evaluated from counters after every mutation.
+     *
+     * Callbacks may mutate the tracker, for example to compact it or remove regions. They only run once the call that
+     * crossed the watermark has its result, so a position allocate returns is already where the region is after them.
+     * Searches and diagnose_allocation only note crossings, whose callbacks run at the end of the next mutating call.
+     * Crossings caused by a callback are handled in the same round, up to 16 callbacks per call.
+     *
+     * @param low The low watermark in [0, 1].
+     * @param high The high watermark in [0, 1].
+     * @param callback Called on each crossing, an empty callback removes the watermarks.
+     */
+    void set_usage_watermarks(double low, double high, WatermarkCallback callback);
+
+    /**
+     * @brief Calls back when the largest free block grows to high or shrinks to low elements.
+     *
+     * Works like set_usage_watermarks. Falling below low is the cue to compact or evict before an allocation fails.
+     */
+    void set_largest_free_block_watermarks(unsigned int low, unsigned int high, WatermarkCallback callback);
+
+    /**
+     * @brief Reports used, reserved and wasted space, see UsageStats.
+     */
+    UsageStats get_usage_stats() const;
+
+    /**
+     * @brief The allocation unit in elements that this tracker was constructed with.
+     */
+    unsigned int get_granule_size() const;
+
     /**
      * @brief Finds the first contiguous region of free space large enough to fit the requested length.
-     * @param length The number of contiguous elements required.
+     * @param length The number of contiguous elements required, rounded up to its size class and to whole granules
+     * internally.
      * @return An optional starting index for the free region, or std::nullopt if none found.
      */
     std::optional<unsigned int> find_contiguous_space(unsigned int length);
 
+    /**
+     * @brief Starts or stops recording the lengths passed to find_contiguous_space and add_metadata.
+     */
+    void set_profiling(bool enabled);
+
+    /**
+     * @brief The lengths recorded while profiling was enabled, see AllocationProfile::compute_size_classes.
+     */
+    const AllocationProfile &get_allocation_profile() const;
+
+    /**
+     * @brief Records a sample of the calls to add_metadata and remove_metadata into sampler, nullptr stops.
+     *
+     * The sampler isn't owned and must outlive the tracker or be detached first. Calls that aren't sampled only
+     * count down to the next sample, see EventSampler.
+     */
+    void set_event_sampler(EventSampler *sampler);
+
+    /**
+     * @brief Switches the tracker to segregated fit using the given size classes.
+     *
+     * Every new region reserves space for the smallest class that holds its length, so freed regions come back in a
+     * handful of exact sizes that the quick lists (see set_quick_list_limit) can recycle without coalescing. Lengths
+     * above the largest class are only rounded to whole granules. Existing regions keep what they reserved, and the
+     * extra space shows up as rounding waste in get_usage_stats. An empty config turns segregated fit off.
+     */
+    void set_size_classes(const SizeClassConfig &config);
+
+    /**
+     * @brief Selects how find_contiguous_space picks among fitting gaps, first fit is the default.
+     */
+    void set_placement_policy(PlacementPolicy policy);
+
+    PlacementPolicy get_placement_policy() const;
+
+    /**
+     * @brief Lets the tracker choose its own placement policy from the workload it observes.
+     *
+     * After every window searches, the requested lengths, the search failure rate, the fragmentation and a sample of
+     * region lifetimes are evaluated. With widely varying lengths the tracker moves to best fit when it is under
+     * pressure or regions are long lived, and it moves back to first fit once lengths are uniform and the pressure is
+     * gone. The window after a switch is used to measure its effect, see get_adaptive_stats().
+     *
+     * @param enabled Turns the adaptive mode on or off, the current policy is kept when it's turned off.
+     * @param window The number of searches per observation window.
+     */
+    void set_adaptive_policy(bool enabled, unsigned int window = 256);
+
+    /**
+     * @brief The observations and decisions of the adaptive mode.
+     */
+    const AdaptiveStats &get_adaptive_stats() const;
+
+    /**
+     * @brief Measures external fragmentation as 1 - largest free gap / total free space.
+     *
+     * Ranges parked in the quick lists count in neither term, they are only reusable at their exact length until
+     * the lists are flushed.
+     *
+     * @return A value in [0, 1], 0 when all free space is in a single gap.
+     */
+    double get_fragmentation() const;
+
+    /**
+     * @brief Finds space for a region and adds it in one step.
+     *
+     * Every lifetime grows from its own end of a half of the array: transient regions are placed as low as
+     * possible, frame regions as high as possible below the middle, level regions as low as possible above the
+     * middle and permanent regions as high as possible. So short and long lived regions don't interleave, and a
+     * class only spills into the space of the others once its own is full. The search is counted, profiled and
+     * served from the quick lists like find_contiguous_space, which is the search of transient regions, but a
+     * parked range is only reused if it lies in the half of the class. Best fit only applies to transient regions.
+     *
+     * @param id The identifier for the new region, must not be in use.
+     * @param length The length of the region.
+     * @param lifetime How long the region is expected to live.
+     * @return The start of the new region, or std::nullopt if the id is taken or there is no room.
+     */
+    std::optional<unsigned int> allocate(int id, unsigned int length, Lifetime lifetime = Lifetime::transient);
+
+    /**
+     * @brief Reports how tightly the regions allocated with a given lifetime are packed.
+     *
+     * Regions added through add_metadata have no lifetime and aren't counted in any class.
+     */
+    LifetimeStats get_lifetime_stats(Lifetime lifetime) const;
+
+    /**
+     * @brief Enables the exact-size quick lists that sit in front of the gap index.
+     *
+     * While enabled, removed regions are parked on a LIFO list keyed by their length in granules instead of being
+     * coalesced, and the next search for that length is answered from the list in O(1). Once more than
+     * max_entries regions are parked, or compact() runs, everything is returned to the gap index at once.
+     *
+     * @param max_entries The bound on the number of parked regions, 0 disables the quick lists.
+     */
+    void set_quick_list_limit(unsigned int max_entries);
+
+    /**
+     * @brief Hit, miss and flush counters for the quick lists.
+     */
+    QuickListStats get_quick_list_stats() const;
+
+    /**
+     * @brief Counts of searches, additions, removals, expirations and compactions, see TrackerRegistry for totals.
+     */
+    OperationStats get_operation_stats() const;
+
+    /**
+     * @brief The operation counts next to the region count, usage and free space, all safe to read from any thread.
+     *
+     * The usage and free space figures are brought up to date at the end of every call that changes them.
+     */
+    const TrackerCounters &get_counters() const;
+
+    /**
+     * @brief Explains whether a request of the given length fits and, if not, the cheapest ways to make it fit.
+     *
+     * Everything is derived from the gap index: the totals in O(1) and the compaction and eviction windows with one
+     * pass over the gaps, regions are only visited to list the eviction candidates. Like a failing search, this
+     * flushes the quick lists first.
+     */
+    AllocationDiagnostics diagnose_allocation(unsigned int length);
+
     /**
      * @brief Adds a new metadata entry corresponding to an allocated region.
      * @param id The identifier for the metadata entry.
      * @param start The starting index of the region.
      * @param length The length of the region.
-     * @return True if the metadata was added successfully; false if the region overlaps or is invalid.
+     * @return True if the metadata was added successfully; false if the region overlaps, is out of bounds or
+     * doesn't start on a granule boundary.
      */
     bool add_metadata(int id, unsigned int start, unsigned int length);
 
+    /**
+     * @brief Checks a whole batch of placements before any of them is added, see BulkPlacementValidator.
+     *
+     * Placement i is starts[i] and lengths[i] as add_metadata takes them. It is rejected if add_metadata would refuse
+     * it on the current layout, being unaligned, out of bounds or colliding with a region, or if it collides with
+     * another placement of the batch, in which case both are rejected unless one of them is empty. What's left can be
+     * added in any order. Ids are not checked. The quick lists are flushed first, their ranges count as free.
+     *
+     * @return One bit per placement, set if it is rejected, bit i % 64 of word i / 64.
+     */
+    std::vector<std::uint64_t> validate_placements(const unsigned int *starts, const unsigned int *lengths,
+                                                   std::size_t count);
+
+    /**
+     * @brief A region as add_metadata takes it.
+     */
+    struct Placement {
+        int id;
+        unsigned int start;
+        unsigned int length;
+    };
+
+    /**
+     * @brief Replaces every region with a known layout in time linear in its size.
+     *
+     * The result is the one of removing every region and calling add_metadata per placement, but the layout is
+     * validated in a single pass and the indexes are built from it directly instead of being searched per region.
+     * TTLs, lifetimes, shared regions and parked quick list ranges go away with the old regions.
+     *
+     * @param placements Sorted by start. Empty regions may share a start with any other region.
+     * @return False, leaving the tracker unchanged, if the placements aren't sorted, are unaligned, out of bounds or
+     * overlap, or repeat an id.
+     */
+    bool assign_sorted(const std::vector<Placement> &placements);
+
+    /**
+     * @brief Allocates a region for content that other ids may already hold, sharing it instead of duplicating it.
+     *
+     * If a region with the same content hash exists, id becomes another reference to it and no space is allocated.
+     * Otherwise a new region is allocated like allocate does. get_metadata returns the shared range for every
+     * reference, but get_all_metadata only lists the region once, under the id that currently owns it. The region
+     * is freed when its last reference is removed; if the owner goes first, ownership moves to another reference.
+     * Shared regions can't be split, merged, trimmed or given a TTL.
+     *
+     * @param id The identifier for the new reference, must not be in use.
+     * @param length The length of the content, must match the length of an existing region with the same hash.
+     * @param content_hash A hash of the content, equal hashes are treated as equal content.
+     * @param lifetime Used if a new region has to be allocated.
+     * @return The start of the shared region, or std::nullopt if the id is taken or there is no room.
+     */
+    std::optional<unsigned int> allocate_shared(int id, unsigned int length, std::uint64_t content_hash,
+                                                Lifetime lifetime = Lifetime::transient);
+
+    /**
+     * @brief The number of ids referencing the region of id, 1 for unshared regions and 0 for unknown ids.
+     */
+    unsigned int get_reference_count(int id) const;
+
     /**
      * @brief Removes a metadata entry and frees its associated region.
+     *
+     * For a shared region this only drops the reference held by id.
+     *
      * @param id The identifier of the metadata entry to remove.
      */
     void remove_metadata(int id);
 
+    /**
+     * @brief Splits a region in two without moving any of its data.
+     *
+     * The region keeps its first offset elements under id and the remainder becomes a new region
+     * under new_id. Runs in O(log n) since the split can't collide with anything.
+     *
+     * @param id The identifier of the region to split.
+     * @param offset Where to split, relative to the start of the region. Must be a non-zero multiple of the granule
+     * size that is smaller than the region's length.
+     * @param new_id The identifier for the trailing part, must not be in use.
+     * @return True if the region was split.
+     */
+    bool split(int id, unsigned int offset, int new_id);
+
+    /**
+     * @brief Fuses two adjacent regions into one without moving any of their data.
+     *
+     * The combined region is kept under id_a and id_b is removed. The regions may be given in either order, but the
+     * first one in the array must fill its last granule, otherwise the result would not be contiguous.
+     *
+     * @param id_a The identifier that survives the merge.
+     * @param id_b The identifier that is absorbed.
+     * @return True if the regions were merged.
+     */
+    bool merge(int id_a, int id_b);
+
+    /**
+     * @brief Releases the first n elements of a region, the rest of the region stays where it is.
+     * @param id The identifier of the region to shrink.
+     * @param n The number of leading elements to free. Must be a multiple of the granule size so the region keeps a
+     * granule aligned start, and smaller than the region's length; use remove_metadata to free all of it.
+     * @return True if the region was trimmed.
+     */
+    bool trim_front(int id, unsigned int n);
+
+    /**
+     * @brief Releases the last n elements of a region, the rest of the region stays where it is.
+     *
+     * Only granules that are no longer touched by the region are returned to the free space.
+     *
+     * @param id The identifier of the region to shrink.
+     * @param n The number of trailing elements to free, must be smaller than the region's length.
+     * @return True if the region was trimmed.
+     */
+    bool trim_back(int id, unsigned int n);
+
+    /**
+     * @brief Makes a region expire at a given time, replacing any earlier expiry.
+     *
+     * Time is whatever monotonic unit the caller passes to advance. A region that merges another keeps its own
+     * expiry, and the parts created by split don't inherit one.
+     *
+     * @return True if the region exists.
+     */
+    bool set_ttl(int id, unsigned long long expires_at);
+
+    /**
+     * @brief Removes the expiry of a region.
+     * @return True if the region had one.
+     */
+    bool clear_ttl(int id);
+
+    /**
+     * @brief The time a region expires at, or std::nullopt if it doesn't expire.
+     */
+    std::optional<unsigned long long> get_ttl(int id) const;
+
+    /**
+     * @brief Moves time forward and removes every region that has expired by now.
+     *
+     * Expired regions are found through a hierarchical timer wheel in O(expired) time and their space is returned
+     * to the gap index in a single coalescing pass, bypassing the quick lists.
+     *
+     * @param now The current time.
+     * @return The ids of the removed regions.
+     */
+    std::vector<int> advance(unsigned long long now);
+
     /**
      * @brief Retrieves the metadata associated with a given ID.
      * @param id The identifier to query.
@@ -66,6 +581,97 @@ class FixedSizeArrayTracker {
      */
     std::optional<std::pair<unsigned int, unsigned int>> get_metadata(int id) const;
 
+    /**
+     * @brief The id of the region whose reserved granules contain position, aliases resolve to the owner.
+     */
+    std::optional<int> get_owner(unsigned int position) const;
+
+    /**
+     * @brief Keeps radix indexes of region and gap starts next to the ordered ones, meant for huge arrays.
+     *
+     * With them the range check of add_metadata, get_owner and the lookups of a region's reserved granules each
+     * cost one predecessor query, O(log64 granule count), instead of a tree search over all regions or gaps. The
+     * bitsets take about granule_count / 4 bytes whether the array is used or not, see get_index_memory.
+     */
+    void set_radix_index(bool enabled);
+
+    struct IndexMemory {
+        /// the B+tree of region intervals.
+        std::size_t interval_index_bytes = 0;
+        /// both radix indexes, 0 unless set_radix_index is on.
+        std::size_t radix_index_bytes = 0;
+    };
+
+    IndexMemory get_index_memory() const;
+
+    /**
+     * @brief The bytes a tracker holds, split by what they are used for.
+     *
+     * Heap memory is counted from the sizes and capacities of the containers, so it is what was requested from the
+     * allocator without the allocator's own overhead.
+     */
+    struct MemoryFootprint {
+        /// sizeof the tracker, including everything stored inline such as the epoch reclaimer's reader slots.
+        std::size_t object_bytes = 0;
+        /// the metadata map, plus the lock free copy of it and the tables it retired while concurrent reads are on.
+        std::size_t metadata_bytes = 0;
+        /// the B+tree of region intervals, plus the radix index of region starts and the concurrent copy if they're on.
+        std::size_t interval_index_bytes = 0;
+        /// both gap indexes, plus the radix index of gap starts if it is on.
+        std::size_t gap_index_bytes = 0;
+        /// quick lists, shared regions, lifetimes, TTLs, the allocation profile and the rest of the bookkeeping.
+        std::size_t auxiliary_bytes = 0;
+        std::size_t total_bytes = 0;
+    };
+
+    /**
+     * @brief Reports the memory this tracker uses, see TrackerRegistry for the total of a process.
+     *
+     * O(1) apart from one step per distinct quick list length and per shared region, and one per region while
+     * set_concurrent_search is on.
+     */
+    MemoryFootprint memory_footprint() const;
+
+    /**
+     * @brief Turns the lock free read path of get_metadata_concurrent on or off.
+     *
+     * While it's on, every change to a region is mirrored into a table that other threads can read without locking,
+     * which costs a few extra stores per mutation. Must be called from the thread that mutates the tracker. Lookups
+     * racing the call that turns it on or off may find nothing for regions that exist, calls that don't change the
+     * setting do nothing.
+     */
+    void set_concurrent_reads(bool enabled);
+
+    /**
+     * @brief Like get_metadata, but safe to call from any thread while a single other thread mutates the tracker.
+     *
+     * Never takes a lock, a lookup only retries if it races the writer on the same table slot. Each result is the
+     * region as it was at some point during the call. Returns std::nullopt unless set_concurrent_reads is on.
+     */
+    std::optional<std::pair<unsigned int, unsigned int>> get_metadata_concurrent(int id) const;
+
+    /**
+     * @brief Turns the lock free search of find_contiguous_space_concurrent on or off.
+     *
+     * While it's on, the region intervals are mirrored into a ConcurrentIntervalSkipList, which costs a skip list
+     * insert or remove per mutation, compact and assign_sorted swap in the new layout at once. Must be called from
+     * the thread that mutates the tracker and not while other threads search, calls that don't change the setting
+     * do nothing.
+     */
+    void set_concurrent_search(bool enabled);
+
+    /**
+     * @brief A first fit search like find_contiguous_space, safe to call from any thread while a single other
+     * thread mutates the tracker.
+     *
+     * Never takes a lock and skips whole spans of the array by the skip list's gap hints. The start is free at some
+     * point during the call, and ranges parked in quick lists count as free. Nothing is reserved, a caller has to
+     * hand the start to the mutating thread, which may find it taken by then. length is only rounded up to whole
+     * granules, with size classes on the caller passes the rounded length. Returns std::nullopt unless
+     * set_concurrent_search is on.
+     */
+    std::optional<unsigned int> find_contiguous_space_concurrent(unsigned int length) const;
+
     /**
      * @brief Rearranges metadata to eliminate gaps between allocated regions.
      *
@@ -74,6 +680,40 @@ class FixedSizeArrayTracker {
      */
     void compact();
 
+    /**
+     * @brief A hash of the current layout, i.e. the set of (id, start, length) triples in get_all_metadata().
+     *
+     * The hash is the sum of a per-region hash, so it doesn't depend on the order regions were added in and is kept
+     * up to date in O(1) per mutation. Two trackers with the same layout always have the same fingerprint, and
+     * different layouts collide with a probability of about 2^-64.
+     */
+    std::uint64_t get_layout_fingerprint() const;
+
+    /**
+     * @brief The number of 64 bit words an occupancy bitset in the given unit needs.
+     */
+    std::size_t occupancy_bitset_words(OccupancyUnit unit) const;
+
+    /**
+     * @brief Writes a dense occupancy bitset into a caller provided buffer.
+     *
+     * Bit i lives in words[i / 64] at position i % 64. Built from the interval index with word at a time fills, so
+     * it costs O(regions + bits / 64). Also resets the dirty ranges used by update_occupancy_bitset.
+     *
+     * @return False if word_count is smaller than occupancy_bitset_words(unit), in which case nothing is written.
+     */
+    bool export_occupancy_bitset(std::uint64_t *words, std::size_t word_count, OccupancyUnit unit);
+
+    /**
+     * @brief Brings a bitset written by export_occupancy_bitset up to date by rebuilding only the ranges that changed.
+     *
+     * There is a single set of dirty ranges per tracker, so this is meant for one consumer buffer at a time, which
+     * must have been exported with the same unit.
+     *
+     * @return False if word_count is smaller than occupancy_bitset_words(unit), in which case nothing is written.
+     */
+    bool update_occupancy_bitset(std::uint64_t *words, std::size_t word_count, OccupancyUnit unit);
+
     /**
      * @brief Produces a human-readable string representation of the current tracker state.
      * @return A formatted string containing metadata and layout visualization.
@@ -100,11 +740,250 @@ class FixedSizeArrayTracker {
 
     LogSection::LogMode log_mode = LogSection::LogMode::disable;
 
+    /// the allocation unit in elements.
+    unsigned int granule_size = 1;
+
+    /// the number of whole granules that fit in the array, size / granule_size.
+    unsigned int granule_count = 0;
+
     /// maps metadata ids to their associated regions (start index and length).
     std::unordered_map<int, std::pair<unsigned int, unsigned int>> metadata;
 
-    /// stores occupied regions as sorted intervals (start, end).
-    std::set<std::pair<unsigned int, unsigned int>> occupied_intervals;
+    /// the granule intervals [start, end) of all non-empty regions with their ids, in address order.
+    IntervalBPlusTree occupied_intervals;
+
+    /// radix mirrors of occupied_intervals and free_gaps, present while set_radix_index is on.
+    std::optional<RadixIntervalIndex> radix_regions;
+    std::optional<RadixIntervalIndex> radix_gaps;
+
+    /// maps the start of every maximal free gap to its end, in granules. adjacent gaps are always coalesced.
+    std::map<unsigned int, unsigned int> free_gaps;
+
+    /// the same gaps as free_gaps ordered by (length, start), so the largest gap is the last element.
+    std::set<std::pair<unsigned int, unsigned int>> free_gaps_by_length;
+
+    /// freed ranges that haven't been returned to the gap index yet, keyed by exact length in granules. each list
+    /// holds range starts in granules and is used as a stack, so the most recently freed range is reused first.
+    std::unordered_map<unsigned int, std::vector<unsigned int>> quick_lists;
+
+    /// the number of ranges parked in quick_lists.
+    unsigned int quick_list_entries = 0;
+
+    /// the granules held by the ranges parked in quick_lists, free but not in the gap index.
+    unsigned int quick_list_granules = 0;
+
+    /// when quick_list_entries exceeds this the lists are flushed, 0 disables them.
+    unsigned int quick_list_limit = 0;
+
+    QuickListStats quick_list_stats;
+
+    TrackerCounters counters;
+
+    PlacementPolicy placement_policy = PlacementPolicy::first_fit;
+
+    bool profiling_enabled = false;
+    AllocationProfile allocation_profile;
+
+    EventSampler *event_sampler = nullptr;
+
+    /// add_metadata and remove_metadata calls left until the next sample, never runs out without a sampler.
+    std::uint64_t sample_countdown = std::numeric_limits<std::uint64_t>::max();
+
+    /// the classes new regions are rounded up to, empty unless segregated fit is on.
+    SizeClassConfig size_classes;
+
+    /// what the adaptive mode has accumulated over the current window.
+    struct AdaptiveWindow {
+        unsigned int searches = 0;
+        unsigned int failures = 0;
+        double size_sum = 0.0;
+        double size_square_sum = 0.0;
+        double lifetime_sum = 0.0;
+        unsigned int lifetime_samples = 0;
+    };
+
+    static constexpr std::size_t max_adaptive_decisions = 16;
+    /// one in this many added regions has its lifetime measured.
+    static constexpr unsigned long long adaptive_lifetime_sample_rate = 8;
+
+    bool adaptive_policy_enabled = false;
+    unsigned int adaptive_window_length = 256;
+    AdaptiveWindow adaptive_window;
+    AdaptiveStats adaptive_stats;
+
+    /// counts add_metadata calls while the adaptive mode is on, lifetimes are measured in this clock.
+    unsigned long long adaptive_clock = 0;
+
+    /// the adaptive_clock value at which each sampled region was added.
+    std::unordered_map<int, unsigned long long> sampled_births;
+
+    enum class WatermarkSide { between, above_high, below_low };
+
+    struct Watermark {
+        double low = 0.0;
+        double high = 0.0;
+        WatermarkCallback callback;
+        /// the side that fired last, which can't fire again until the other one has.
+        WatermarkSide side = WatermarkSide::between;
+    };
+
+    /// indexed by WatermarkMetric.
+    std::array<Watermark, 2> watermarks;
+
+    struct PendingCrossing {
+        WatermarkMetric metric;
+        WatermarkCrossing crossing;
+        double value;
+    };
+
+    static constexpr std::size_t max_watermark_callbacks = 16;
+
+    /// crossings noticed but not yet passed to their callback, in the order they happened.
+    std::vector<PendingCrossing> pending_crossings;
+
+    /// set while callbacks run, so the mutations they make queue their crossings instead of running callbacks
+    /// recursively.
+    bool checking_watermarks = false;
+
+    /// public calls running inside another public call, which runs the callbacks once it has its result.
+    unsigned int nested_operations = 0;
+
+    /// maps the content hash of each shared region to the ids referencing it. the first id owns the region and is
+    /// the only one present in metadata.
+    std::unordered_map<std::uint64_t, std::vector<int>> shared_regions;
+
+    /// the content hash of every id referencing a shared region.
+    std::unordered_map<int, std::uint64_t> content_hash_of_id;
+
+    /// expiry times of the regions that have one.
+    HierarchicalTimerWheel ttl_wheel;
+
+    static constexpr std::size_t lifetime_count = 4;
+
+    /// the lifetime of every region placed through allocate.
+    std::unordered_map<int, Lifetime> region_lifetimes;
+
+    /// the granule intervals of the regions of each lifetime, indexed by the Lifetime value.
+    std::array<std::set<std::pair<unsigned int, unsigned int>>, lifetime_count> lifetime_intervals;
+
+    /// the granules reserved by the regions of each lifetime, indexed by the Lifetime value.
+    std::array<unsigned int, lifetime_count> lifetime_used_granules{};
+
+    /// the sum of the requested lengths of all regions, in elements.
+    unsigned int used_elements = 0;
+
+    /// the sum of the lengths of all regions in granules.
+    unsigned int used_granules = 0;
+
+    static constexpr std::size_t max_dirty_ranges = 256;
+
+    /// granule ranges whose occupancy changed since the last bitset export or update.
+    std::vector<std::pair<unsigned int, unsigned int>> dirty_ranges;
+
+    /// the sum of fingerprint_region over all regions, wrapping.
+    std::uint64_t layout_fingerprint = 0;
+
+    bool concurrent_reads_enabled = false;
+
+    /// a copy of get_metadata for every id, aliases included, kept while concurrent reads are on.
+    SeqlockMetadataTable concurrent_metadata;
+
+    /// a mirror of occupied_intervals, present while set_concurrent_search is on.
+    std::optional<ConcurrentIntervalSkipList> concurrent_intervals;
+
+    /// false while compact rebuilds occupied_intervals, the mirror is replaced in one step afterwards.
+    bool mirror_intervals = true;
+
+    /// replaces the contents of concurrent_intervals with occupied_intervals.
+    void publish_intervals();
+
+    /// the number of granules needed to hold length elements.
+    unsigned int granules_for(unsigned int length) const;
+
+    /// true if the granules [start, start + length) are free and inside the array.
+    bool is_free(unsigned int start, unsigned int length) const;
+
+    /// removes the free granules [start, start + length) from the gap index.
+    void occupy_granules(unsigned int start, unsigned int length);
+
+    /// returns the granules [start, start + length) to the gap index, coalescing with neighboring gaps.
+    void release_granules(unsigned int start, unsigned int length);
+
+    void mark_dirty(unsigned int start, unsigned int end);
+
+    /// sets or clears bits [begin, end), whole words at a time where possible.
+    static void fill_bits(std::uint64_t *words, std::size_t begin, std::size_t end, bool value);
+
+    /// sets the bits of every region overlapping the granules [start, end), clipped to that range.
+    void fill_occupancy(std::uint64_t *words, OccupancyUnit unit, unsigned int start, unsigned int end) const;
+
+    /// mirrors the range of a region, and of every alias sharing it, into concurrent_metadata.
+    void publish_region(int id, unsigned int start, unsigned int length);
+
+    static std::uint64_t fingerprint_region(int id, unsigned int start, unsigned int length);
+
+    /// the number of granules a new region of this length reserves, including size class rounding.
+    unsigned int reserved_granules_for(unsigned int length) const;
+
+    /// the number of granules an existing region reserves, read from the interval index.
+    unsigned int reserved_granules_of(unsigned int start, unsigned int length) const;
+
+    /// adds a region reserving length_in_granules to metadata and to every index keyed by region, its granules must
+    /// already be taken out of the gap index.
+    void index_region(int id, unsigned int start, unsigned int length, unsigned int length_in_granules);
+
+    /// removes a region from metadata and from every index keyed by region, its granules are left to the caller.
+    /// returns the number of granules the region reserved.
+    unsigned int unindex_region(int id);
+
+    /// the gap search behind find_contiguous_space, in granules.
+    std::optional<unsigned int> search_gaps(unsigned int length_in_granules, Lifetime lifetime);
+
+    /// find_contiguous_space for a region of the given lifetime, see allocate.
+    std::optional<unsigned int> find_space(unsigned int length, Lifetime lifetime);
+
+    /// true if the granules [start, start + length_in_granules) lie in the half lifetime is placed in first.
+    bool in_zone(unsigned int start, unsigned int length_in_granules, Lifetime lifetime) const;
+
+    /// the placement of a frame, level or permanent region within its zone, see allocate.
+    std::optional<unsigned int> search_zone(unsigned int length_in_granules, Lifetime lifetime);
+
+    /// feeds a search into the current adaptive window and evaluates the window once it is full.
+    void observe_search(unsigned int length_in_granules, bool found);
+    void evaluate_adaptive_window();
+
+    void set_watermark(Watermark &watermark, double low, double high, WatermarkCallback callback, double value);
+
+    /// publishes the counters, queues the watermarks crossed since the last check and, if fire is set and no outer
+    /// call is running, runs the callbacks of everything queued.
+    void check_watermarks(bool fire = true);
+
+    /// copies the region count, usage and free space into counters.
+    void publish_counters();
+
+    /// true if id owns a region or references a shared one.
+    bool id_in_use(int id) const;
+
+    bool is_shared(int id) const;
+
+    /// drops the reference id holds on a shared region, handing the region to another reference if id owned it.
+    /// returns true if the region has no references left and should be freed, which is also the case for unshared
+    /// regions.
+    bool release_reference(int id);
+
+    /// add_metadata and remove_metadata without the sampling around them.
+    bool add_metadata_unsampled(int id, unsigned int start, unsigned int length);
+    void remove_metadata_unsampled(int id);
+
+    /// removes a region from every structure that knows its id and returns the number of granules it reserved,
+    /// which are left to the caller.
+    unsigned int drop_region(int id);
+
+    /// returns every range parked in the quick lists to the gap index.
+    void flush_quick_lists();
+
+    void insert_gap(unsigned int start, unsigned int end);
+    void erase_gap(std::map<unsigned int, unsigned int>::iterator gap);
 };
 
 #endif // FIXED_SIZE_ARRAY_TRACKER_HPP
@@ -0,0 +1,832 @@
+#include "interval_bplus_tree.hpp"
+#include <algorithm>
+#include <utility>
+
+IntervalBPlusTree::Iterator::Iterator(const IntervalBPlusTree *tree, const Leaf *leaf, unsigned int index)
+    : tree(tree), leaf(leaf), index(index) {}
+
+IntervalBPlusTree::Entry IntervalBPlusTree::Iterator::operator*() const {
+    return {leaf->starts[index], leaf->ends[index], leaf->ids[index]};
+}
+
+IntervalBPlusTree::Iterator &IntervalBPlusTree::Iterator::operator++() {
+    if (++index == leaf->count) {
+        leaf = leaf->next;
+        index = 0;
+    }
+    return *this;
+}
+
+IntervalBPlusTree::Iterator &IntervalBPlusTree::Iterator::operator--() {
+    if (!leaf) {
+        leaf = tree->last_leaf;
+        index = leaf->count - 1;
+    } else if (index == 0) {
+        leaf = leaf->prev;
+        index = leaf->count - 1;
+    } else {
+        index--;
+    }
+    return *this;
+}
+
+bool IntervalBPlusTree::Iterator::operator==(const Iterator &other) const {
+    return leaf == other.leaf && (!leaf || index == other.index);
+}
+
+bool IntervalBPlusTree::Iterator::operator!=(const Iterator &other) const { return !(*this == other); }
+
+IntervalBPlusTree::Leaf::Leaf() { starts.fill(UINT_MAX); }
+
+IntervalBPlusTree::Inner::Inner() { first_start.fill(UINT_MAX); }
+
+IntervalBPlusTree::IntervalBPlusTree(unsigned int capacity) : capacity(capacity) {}
+
+IntervalBPlusTree::IntervalBPlusTree(const IntervalBPlusTree &other)
+    : capacity(other.capacity), height(other.height), root_summary(other.root_summary), entry_count(other.entry_count),
+      leaf_count(other.leaf_count), inner_count(other.inner_count) {
+    Leaf *previous_leaf = nullptr;
+    root = other.root ? clone(other.root, 0, previous_leaf) : nullptr;
+    last_leaf = previous_leaf;
+}
+
+IntervalBPlusTree::IntervalBPlusTree(IntervalBPlusTree &&other) noexcept
+    : capacity(other.capacity), root(other.root), height(other.height), first_leaf(other.first_leaf),
+      last_leaf(other.last_leaf), root_summary(other.root_summary), entry_count(other.entry_count),
+      leaf_count(other.leaf_count), inner_count(other.inner_count) {
+    other.root = nullptr;
+    other.first_leaf = nullptr;
+    other.last_leaf = nullptr;
+    other.height = 0;
+    other.entry_count = 0;
+    other.leaf_count = 0;
+    other.inner_count = 0;
+}
+
+IntervalBPlusTree &IntervalBPlusTree::operator=(const IntervalBPlusTree &other) {
+    if (this != &other) {
+        IntervalBPlusTree copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+IntervalBPlusTree &IntervalBPlusTree::operator=(IntervalBPlusTree &&other) noexcept {
+    if (this != &other) {
+        clear();
+        capacity = other.capacity;
+        std::swap(root, other.root);
+        std::swap(height, other.height);
+        std::swap(first_leaf, other.first_leaf);
+        std::swap(last_leaf, other.last_leaf);
+        std::swap(root_summary, other.root_summary);
+        std::swap(entry_count, other.entry_count);
+        std::swap(leaf_count, other.leaf_count);
+        std::swap(inner_count, other.inner_count);
+    }
+    return *this;
+}
+
+IntervalBPlusTree::~IntervalBPlusTree() { clear(); }
+
+void *IntervalBPlusTree::clone(const void *node, unsigned int depth, Leaf *&previous_leaf) {
+    if (depth == height) {
+        auto *leaf = new Leaf(*static_cast<const Leaf *>(node));
+        leaf->prev = previous_leaf;
+        leaf->next = nullptr;
+        if (previous_leaf) {
+            previous_leaf->next = leaf;
+        } else {
+            first_leaf = leaf;
+        }
+        previous_leaf = leaf;
+        return leaf;
+    }
+
+    auto *inner = new Inner(*static_cast<const Inner *>(node));
+    for (unsigned int i = 0; i < inner->count; ++i) {
+        inner->children[i] = clone(inner->children[i], depth + 1, previous_leaf);
+    }
+    return inner;
+}
+
+void IntervalBPlusTree::destroy(void *node, unsigned int depth) {
+    if (depth == height) {
+        delete static_cast<Leaf *>(node);
+        return;
+    }
+    auto *inner = static_cast<Inner *>(node);
+    for (unsigned int i = 0; i < inner->count; ++i) {
+        destroy(inner->children[i], depth + 1);
+    }
+    delete inner;
+}
+
+std::size_t IntervalBPlusTree::memory_bytes() const {
+    return leaf_count * sizeof(Leaf) + inner_count * sizeof(Inner);
+}
+
+void IntervalBPlusTree::clear() {
+    if (root) {
+        destroy(root, 0);
+    }
+    root = nullptr;
+    height = 0;
+    first_leaf = nullptr;
+    last_leaf = nullptr;
+    entry_count = 0;
+    leaf_count = 0;
+    inner_count = 0;
+}
+
+void IntervalBPlusTree::assign_sorted(const std::vector<Entry> &entries) {
+    clear();
+    if (entries.empty()) {
+        return;
+    }
+
+    // every level spreads its entries evenly over as few nodes as possible, which keeps each of them above min_fill
+    std::size_t count = entries.size();
+    std::size_t leaves = (count + fanout - 1) / fanout;
+    std::vector<void *> level;
+    level.reserve(leaves);
+    std::size_t next = 0;
+    for (std::size_t node = 0; node < leaves; ++node) {
+        auto *leaf = new Leaf();
+        leaf_count++;
+        std::size_t take = count / leaves + (node < count % leaves ? 1 : 0);
+        for (; leaf->count < take; ++next) {
+            leaf->starts[leaf->count] = entries[next].start;
+            leaf->ends[leaf->count] = entries[next].end;
+            leaf->ids[leaf->count] = entries[next].id;
+            leaf->count++;
+        }
+        leaf->prev = last_leaf;
+        if (last_leaf) {
+            last_leaf->next = leaf;
+        } else {
+            first_leaf = leaf;
+        }
+        last_leaf = leaf;
+        level.push_back(leaf);
+    }
+
+    bool children_are_leaves = true;
+    while (level.size() > 1) {
+        std::size_t parent_count = (level.size() + fanout - 1) / fanout;
+        std::vector<void *> parents;
+        parents.reserve(parent_count);
+        std::size_t child = 0;
+        for (std::size_t node = 0; node < parent_count; ++node) {
+            auto *inner = new Inner();
+            inner_count++;
+            std::size_t take = level.size() / parent_count + (node < level.size() % parent_count ? 1 : 0);
+            for (; inner->count < take; ++child) {
+                insert_child(inner, inner->count, level[child], summarize(level[child], children_are_leaves));
+            }
+            parents.push_back(inner);
+        }
+        level.swap(parents);
+        children_are_leaves = false;
+        height++;
+    }
+
+    root = level.front();
+    root_summary = summarize(root, height == 0);
+    entry_count = count;
+}
+
+std::size_t IntervalBPlusTree::size() const { return entry_count; }
+
+bool IntervalBPlusTree::empty() const { return entry_count == 0; }
+
+unsigned int IntervalBPlusTree::count_of(const void *node, bool is_leaf) {
+    return is_leaf ? static_cast<const Leaf *>(node)->count : static_cast<const Inner *>(node)->count;
+}
+
+IntervalBPlusTree::Summary IntervalBPlusTree::summarize(const void *node, bool is_leaf) {
+    if (is_leaf) {
+        const auto *leaf = static_cast<const Leaf *>(node);
+        unsigned int max_gap = 0;
+        for (unsigned int i = 1; i < leaf->count; ++i) {
+            max_gap = std::max(max_gap, leaf->starts[i] - leaf->ends[i - 1]);
+        }
+        return {leaf->starts[0], leaf->ends[leaf->count - 1], max_gap};
+    }
+
+    const auto *inner = static_cast<const Inner *>(node);
+    unsigned int max_gap = inner->max_gap[0];
+    for (unsigned int i = 1; i < inner->count; ++i) {
+        max_gap = std::max({max_gap, inner->max_gap[i], inner->first_start[i] - inner->last_end[i - 1]});
+    }
+    return {inner->first_start[0], inner->last_end[inner->count - 1], max_gap};
+}
+
+bool IntervalBPlusTree::refresh(Inner *inner, unsigned int child, bool child_is_leaf) {
+    Summary summary = summarize(inner->children[child], child_is_leaf);
+    bool changed = inner->first_start[child] != summary.first_start || inner->last_end[child] != summary.last_end ||
+                   inner->max_gap[child] != summary.max_gap;
+    inner->first_start[child] = summary.first_start;
+    inner->last_end[child] = summary.last_end;
+    inner->max_gap[child] = summary.max_gap;
+    return changed;
+}
+
+IntervalBPlusTree::Summary IntervalBPlusTree::grown(const Summary &before, const Entry &entry) {
+    // an entry outside the old range adds the gap between it and the range, one inside only shrinks a gap
+    if (entry.start < before.first_start) {
+        return {entry.start, before.last_end, std::max(before.max_gap, before.first_start - entry.end)};
+    }
+    if (entry.start >= before.last_end) {
+        return {before.first_start, entry.end, std::max(before.max_gap, entry.start - before.last_end)};
+    }
+    return before;
+}
+
+void IntervalBPlusTree::pad(std::array<unsigned int, fanout> &keys, unsigned int count) {
+    std::fill(keys.begin() + count, keys.end(), UINT_MAX);
+}
+
+unsigned int IntervalBPlusTree::count_below(const std::array<unsigned int, fanout> &keys, unsigned int key) {
+    // a fixed number of comparisons without early exit, which compiles to a few vector instructions
+    unsigned int below = 0;
+    for (unsigned int i = 0; i < fanout; ++i) {
+        below += keys[i] < key ? 1 : 0;
+    }
+    return below;
+}
+
+unsigned int IntervalBPlusTree::child_for(const Inner *inner, unsigned int start) {
+    // the padding only counts as not above start for start == UINT_MAX, hence the clamp
+    unsigned int not_above = 0;
+    for (unsigned int i = 0; i < fanout; ++i) {
+        not_above += inner->first_start[i] <= start ? 1 : 0;
+    }
+    not_above = std::min(not_above, inner->count);
+    return not_above == 0 ? 0 : not_above - 1;
+}
+
+IntervalBPlusTree::Leaf *IntervalBPlusTree::insert_entry(Leaf *leaf, unsigned int position, const Entry &entry) {
+    if (leaf->count < fanout) {
+        for (unsigned int i = leaf->count; i > position; --i) {
+            leaf->starts[i] = leaf->starts[i - 1];
+            leaf->ends[i] = leaf->ends[i - 1];
+            leaf->ids[i] = leaf->ids[i - 1];
+        }
+        leaf->starts[position] = entry.start;
+        leaf->ends[position] = entry.end;
+        leaf->ids[position] = entry.id;
+        leaf->count++;
+        return nullptr;
+    }
+
+    // a full leaf gives its upper half to a new right sibling, then the entry goes into whichever half covers it
+    auto *right = new Leaf();
+    leaf_count++;
+    unsigned int keep = fanout / 2;
+    right->count = fanout - keep;
+    std::copy(leaf->starts.begin() + keep, leaf->starts.end(), right->starts.begin());
+    std::copy(leaf->ends.begin() + keep, leaf->ends.end(), right->ends.begin());
+    std::copy(leaf->ids.begin() + keep, leaf->ids.end(), right->ids.begin());
+    leaf->count = keep;
+    pad(leaf->starts, keep);
+
+    right->prev = leaf;
+    right->next = leaf->next;
+    if (leaf->next) {
+        leaf->next->prev = right;
+    } else {
+        last_leaf = right;
+    }
+    leaf->next = right;
+
+    if (position <= keep) {
+        insert_entry(leaf, position, entry);
+    } else {
+        insert_entry(right, position - keep, entry);
+    }
+    return right;
+}
+
+IntervalBPlusTree::Inner *IntervalBPlusTree::insert_child(Inner *inner, unsigned int position, void *child,
+                                                          const Summary &summary) {
+    if (inner->count < fanout) {
+        for (unsigned int i = inner->count; i > position; --i) {
+            inner->first_start[i] = inner->first_start[i - 1];
+            inner->last_end[i] = inner->last_end[i - 1];
+            inner->max_gap[i] = inner->max_gap[i - 1];
+            inner->children[i] = inner->children[i - 1];
+        }
+        inner->first_start[position] = summary.first_start;
+        inner->last_end[position] = summary.last_end;
+        inner->max_gap[position] = summary.max_gap;
+        inner->children[position] = child;
+        inner->count++;
+        return nullptr;
+    }
+
+    auto *right = new Inner();
+    inner_count++;
+    unsigned int keep = fanout / 2;
+    right->count = fanout - keep;
+    std::copy(inner->first_start.begin() + keep, inner->first_start.end(), right->first_start.begin());
+    std::copy(inner->last_end.begin() + keep, inner->last_end.end(), right->last_end.begin());
+    std::copy(inner->max_gap.begin() + keep, inner->max_gap.end(), right->max_gap.begin());
+    std::copy(inner->children.begin() + keep, inner->children.end(), right->children.begin());
+    inner->count = keep;
+    pad(inner->first_start, keep);
+
+    if (position <= keep) {
+        insert_child(inner, position, child, summary);
+    } else {
+        insert_child(right, position - keep, child, summary);
+    }
+    return right;
+}
+
+void *IntervalBPlusTree::insert_into(void *node, unsigned int depth, const Entry &entry, bool &inserted,
+                                     bool &changed) {
+    if (depth == height) {
+        auto *leaf = static_cast<Leaf *>(node);
+        unsigned int position = count_below(leaf->starts, entry.start);
+        if (position != leaf->count && leaf->starts[position] == entry.start) {
+            return nullptr;
+        }
+        inserted = true;
+        changed = true;
+        return insert_entry(leaf, position, entry);
+    }
+
+    auto *inner = static_cast<Inner *>(node);
+    bool child_is_leaf = depth + 1 == height;
+    unsigned int child = child_for(inner, entry.start);
+    void *split = insert_into(inner->children[child], depth + 1, entry, inserted, changed);
+    if (!inserted) {
+        return nullptr;
+    }
+    if (split) {
+        refresh(inner, child, child_is_leaf);
+        changed = true;
+        return insert_child(inner, child + 1, split, summarize(split, child_is_leaf));
+    }
+
+    // once a child's summary comes out the same, none of the summaries above it can change either
+    if (!changed) {
+        return nullptr;
+    }
+    Summary before = {inner->first_start[child], inner->last_end[child], inner->max_gap[child]};
+    Summary after = grown(before, entry);
+    changed = after.first_start != before.first_start || after.last_end != before.last_end ||
+              after.max_gap != before.max_gap;
+    inner->first_start[child] = after.first_start;
+    inner->last_end[child] = after.last_end;
+    inner->max_gap[child] = after.max_gap;
+    return nullptr;
+}
+
+bool IntervalBPlusTree::insert(unsigned int start, unsigned int end, int id) {
+    if (!root) {
+        auto *leaf = new Leaf();
+        leaf_count++;
+        root = leaf;
+        first_leaf = leaf;
+        last_leaf = leaf;
+    }
+
+    Entry entry = {start, end, id};
+    bool inserted = false;
+    bool changed = false;
+    void *split = insert_into(root, 0, entry, inserted, changed);
+    if (!inserted) {
+        return false;
+    }
+
+    // a split root gets a new root above it holding both halves
+    if (split) {
+        bool is_leaf = height == 0;
+        auto *new_root = new Inner();
+        inner_count++;
+        insert_child(new_root, 0, root, summarize(root, is_leaf));
+        insert_child(new_root, 1, split, summarize(split, is_leaf));
+        root = new_root;
+        height++;
+        root_summary = summarize(root, false);
+    } else if (entry_count == 0) {
+        root_summary = summarize(root, true);
+    } else if (changed) {
+        root_summary = grown(root_summary, entry);
+    }
+
+    entry_count++;
+    return true;
+}
+
+void IntervalBPlusTree::rebalance(Inner *inner, unsigned int child, bool child_is_leaf) {
+    // pair the child with its right sibling, or its left one if it's the last child
+    unsigned int left_index = child + 1 < inner->count ? child : child - 1;
+    void *left = inner->children[left_index];
+    void *right = inner->children[left_index + 1];
+    unsigned int total = count_of(left, child_is_leaf) + count_of(right, child_is_leaf);
+    unsigned int left_count = total <= fanout ? total : total / 2;
+
+    if (child_is_leaf) {
+        auto *l = static_cast<Leaf *>(left);
+        auto *r = static_cast<Leaf *>(right);
+
+        // concatenate both and split again at left_count, everything goes left when they're merged
+        std::array<unsigned int, fanout * 2> starts;
+        std::array<unsigned int, fanout * 2> ends;
+        std::array<int, fanout * 2> ids;
+        std::copy_n(l->starts.begin(), l->count, starts.begin());
+        std::copy_n(r->starts.begin(), r->count, starts.begin() + l->count);
+        std::copy_n(l->ends.begin(), l->count, ends.begin());
+        std::copy_n(r->ends.begin(), r->count, ends.begin() + l->count);
+        std::copy_n(l->ids.begin(), l->count, ids.begin());
+        std::copy_n(r->ids.begin(), r->count, ids.begin() + l->count);
+
+        l->count = left_count;
+        r->count = total - left_count;
+        pad(l->starts, l->count);
+        pad(r->starts, r->count);
+        std::copy_n(starts.begin(), l->count, l->starts.begin());
+        std::copy_n(ends.begin(), l->count, l->ends.begin());
+        std::copy_n(ids.begin(), l->count, l->ids.begin());
+        std::copy_n(starts.begin() + left_count, r->count, r->starts.begin());
+        std::copy_n(ends.begin() + left_count, r->count, r->ends.begin());
+        std::copy_n(ids.begin() + left_count, r->count, r->ids.begin());
+
+        if (r->count == 0) {
+            l->next = r->next;
+            if (r->next) {
+                r->next->prev = l;
+            } else {
+                last_leaf = l;
+            }
+            delete r;
+            leaf_count--;
+        }
+    } else {
+        auto *l = static_cast<Inner *>(left);
+        auto *r = static_cast<Inner *>(right);
+
+        std::array<unsigned int, fanout * 2> first_start;
+        std::array<unsigned int, fanout * 2> last_end;
+        std::array<unsigned int, fanout * 2> max_gap;
+        std::array<void *, fanout * 2> children;
+        std::copy_n(l->first_start.begin(), l->count, first_start.begin());
+        std::copy_n(r->first_start.begin(), r->count, first_start.begin() + l->count);
+        std::copy_n(l->last_end.begin(), l->count, last_end.begin());
+        std::copy_n(r->last_end.begin(), r->count, last_end.begin() + l->count);
+        std::copy_n(l->max_gap.begin(), l->count, max_gap.begin());
+        std::copy_n(r->max_gap.begin(), r->count, max_gap.begin() + l->count);
+        std::copy_n(l->children.begin(), l->count, children.begin());
+        std::copy_n(r->children.begin(), r->count, children.begin() + l->count);
+
+        l->count = left_count;
+        r->count = total - left_count;
+        pad(l->first_start, l->count);
+        pad(r->first_start, r->count);
+        std::copy_n(first_start.begin(), l->count, l->first_start.begin());
+        std::copy_n(last_end.begin(), l->count, l->last_end.begin());
+        std::copy_n(max_gap.begin(), l->count, l->max_gap.begin());
+        std::copy_n(children.begin(), l->count, l->children.begin());
+        std::copy_n(first_start.begin() + left_count, r->count, r->first_start.begin());
+        std::copy_n(last_end.begin() + left_count, r->count, r->last_end.begin());
+        std::copy_n(max_gap.begin() + left_count, r->count, r->max_gap.begin());
+        std::copy_n(children.begin() + left_count, r->count, r->children.begin());
+
+        if (r->count == 0) {
+            delete r;
+            inner_count--;
+        }
+    }
+
+    refresh(inner, left_index, child_is_leaf);
+    if (total - left_count > 0) {
+        refresh(inner, left_index + 1, child_is_leaf);
+        return;
+    }
+
+    // the right sibling was merged away, close the hole it left
+    for (unsigned int i = left_index + 1; i + 1 < inner->count; ++i) {
+        inner->first_start[i] = inner->first_start[i + 1];
+        inner->last_end[i] = inner->last_end[i + 1];
+        inner->max_gap[i] = inner->max_gap[i + 1];
+        inner->children[i] = inner->children[i + 1];
+    }
+    inner->count--;
+    inner->first_start[inner->count] = UINT_MAX;
+}
+
+bool IntervalBPlusTree::erase_from(void *node, unsigned int depth, unsigned int start, bool &changed) {
+    if (depth == height) {
+        auto *leaf = static_cast<Leaf *>(node);
+        unsigned int position = count_below(leaf->starts, start);
+        if (position == leaf->count || leaf->starts[position] != start) {
+            return false;
+        }
+        for (unsigned int i = position; i + 1 < leaf->count; ++i) {
+            leaf->starts[i] = leaf->starts[i + 1];
+            leaf->ends[i] = leaf->ends[i + 1];
+            leaf->ids[i] = leaf->ids[i + 1];
+        }
+        leaf->count--;
+        leaf->starts[leaf->count] = UINT_MAX;
+        changed = true;
+        return true;
+    }
+
+    auto *inner = static_cast<Inner *>(node);
+    bool child_is_leaf = depth + 1 == height;
+    unsigned int child = child_for(inner, start);
+    if (!erase_from(inner->children[child], depth + 1, start, changed)) {
+        return false;
+    }
+
+    // only the root may be underfull, and it always has at least two children while it's an inner node
+    if (count_of(inner->children[child], child_is_leaf) < min_fill) {
+        rebalance(inner, child, child_is_leaf);
+        changed = true;
+    } else if (changed) {
+        changed = refresh(inner, child, child_is_leaf);
+    }
+    return true;
+}
+
+bool IntervalBPlusTree::erase(unsigned int start) {
+    bool changed = false;
+    if (!root || !erase_from(root, 0, start, changed)) {
+        return false;
+    }
+    entry_count--;
+
+    // an inner root left with a single child hands the root over to it
+    while (height > 0 && static_cast<Inner *>(root)->count == 1) {
+        auto *old_root = static_cast<Inner *>(root);
+        root = old_root->children[0];
+        delete old_root;
+        inner_count--;
+        height--;
+    }
+    if (height == 0 && static_cast<Leaf *>(root)->count == 0) {
+        clear();
+    } else if (changed) {
+        root_summary = summarize(root, height == 0);
+    }
+    return true;
+}
+
+const IntervalBPlusTree::Leaf *IntervalBPlusTree::leaf_for(unsigned int start) const {
+    const void *node = root;
+    for (unsigned int depth = 0; depth < height; ++depth) {
+        const auto *inner = static_cast<const Inner *>(node);
+        node = inner->children[child_for(inner, start)];
+    }
+    return static_cast<const Leaf *>(node);
+}
+
+IntervalBPlusTree::Iterator IntervalBPlusTree::lower_bound(unsigned int start) const {
+    if (!root) {
+        return end();
+    }
+
+    // the leaf that would hold start may end before it, the answer is then the first entry of the next leaf
+    const Leaf *leaf = leaf_for(start);
+    unsigned int index = count_below(leaf->starts, start);
+    if (index == leaf->count) {
+        return Iterator(this, leaf->next, 0);
+    }
+    return Iterator(this, leaf, index);
+}
+
+IntervalBPlusTree::Iterator IntervalBPlusTree::find(unsigned int start) const {
+    Iterator it = lower_bound(start);
+    if (it != end() && it.leaf->starts[it.index] == start) {
+        return it;
+    }
+    return end();
+}
+
+IntervalBPlusTree::Iterator IntervalBPlusTree::begin() const { return Iterator(this, first_leaf, 0); }
+
+IntervalBPlusTree::Iterator IntervalBPlusTree::end() const { return Iterator(this, nullptr, 0); }
+
+std::optional<unsigned int> IntervalBPlusTree::descend_to_gap(unsigned int length) const {
+    const void *node = root;
+    for (unsigned int depth = 0; depth < height; ++depth) {
+        const auto *inner = static_cast<const Inner *>(node);
+        unsigned int i = 0;
+        while (inner->max_gap[i] < length) {
+            if (i + 1 == inner->count) {
+                return std::nullopt;
+            }
+            if (inner->first_start[i + 1] - inner->last_end[i] >= length) {
+                return inner->last_end[i];
+            }
+            ++i;
+        }
+        node = inner->children[i];
+    }
+
+    const auto *leaf = static_cast<const Leaf *>(node);
+    for (unsigned int i = 1; i < leaf->count; ++i) {
+        if (leaf->starts[i] - leaf->ends[i - 1] >= length) {
+            return leaf->ends[i - 1];
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<unsigned int> IntervalBPlusTree::search_gap(void *node, unsigned int depth, unsigned int length) {
+    if (depth == height) {
+        const auto *leaf = static_cast<const Leaf *>(node);
+        for (unsigned int i = 1; i < leaf->count; ++i) {
+            if (leaf->starts[i] - leaf->ends[i - 1] >= length) {
+                return leaf->ends[i - 1];
+            }
+        }
+        return std::nullopt;
+    }
+
+    // children and the gaps between them are visited in address order, the bounds say which children to enter
+    auto *inner = static_cast<Inner *>(node);
+    bool child_is_leaf = depth + 1 == height;
+    for (unsigned int i = 0; i < inner->count; ++i) {
+        if (inner->max_gap[i] >= length) {
+            auto found = search_gap(inner->children[i], depth + 1, length);
+            if (found) {
+                return found;
+            }
+            // the bound was too high, and the search below has already lowered the ones inside the child
+            refresh(inner, i, child_is_leaf);
+        }
+        if (i + 1 < inner->count && inner->first_start[i + 1] - inner->last_end[i] >= length) {
+            return inner->last_end[i];
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<unsigned int> IntervalBPlusTree::find_first_gap(unsigned int length) {
+    if (!root) {
+        return capacity >= length ? std::optional<unsigned int>(0) : std::nullopt;
+    }
+
+    Summary &summary = root_summary;
+    if (summary.first_start >= length) {
+        return 0;
+    }
+    if (summary.max_gap >= length) {
+        // the bounds are mostly exact, so the straight descent usually finds the gap, the search that lowers the
+        // bounds it finds too high only runs when it doesn't
+        auto found = descend_to_gap(length);
+        if (!found) {
+            found = search_gap(root, 0, length);
+        }
+        if (found) {
+            return found;
+        }
+        summary = summarize(root, height == 0);
+    }
+    if (capacity >= summary.last_end && capacity - summary.last_end >= length) {
+        return summary.last_end;
+    }
+    return std::nullopt;
+}
+
+std::optional<unsigned int> IntervalBPlusTree::search_gap_from(void *node, unsigned int depth, unsigned int length,
+                                                               unsigned int from) {
+    // the gap [begin, end) clipped to start at from or later
+    auto fits = [length, from](unsigned int begin, unsigned int end) {
+        begin = std::max(begin, from);
+        return end >= begin && end - begin >= length;
+    };
+
+    if (depth == height) {
+        const auto *leaf = static_cast<const Leaf *>(node);
+        for (unsigned int i = 1; i < leaf->count; ++i) {
+            if (fits(leaf->ends[i - 1], leaf->starts[i])) {
+                return std::max(leaf->ends[i - 1], from);
+            }
+        }
+        return std::nullopt;
+    }
+
+    // a child ending below from + length has nothing left after clipping, only the child holding from can be
+    // entered without finding a gap unless its bound is too high, which gets lowered, so this stays O(log n)
+    // amortized
+    auto *inner = static_cast<Inner *>(node);
+    bool child_is_leaf = depth + 1 == height;
+    for (unsigned int i = 0; i < inner->count; ++i) {
+        if (inner->max_gap[i] >= length &&
+            static_cast<unsigned long long>(inner->last_end[i]) >= static_cast<unsigned long long>(from) + length) {
+            auto found = search_gap_from(inner->children[i], depth + 1, length, from);
+            if (found) {
+                return found;
+            }
+            if (inner->first_start[i] >= from) {
+                refresh(inner, i, child_is_leaf);
+            }
+        }
+        if (i + 1 < inner->count && fits(inner->last_end[i], inner->first_start[i + 1])) {
+            return std::max(inner->last_end[i], from);
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<unsigned int> IntervalBPlusTree::search_gap_until(void *node, unsigned int depth, unsigned int length,
+                                                                unsigned int until) {
+    // the gap [begin, end) clipped to end at until or earlier, the units go against its end
+    auto fits = [length, until](unsigned int begin, unsigned int end) {
+        end = std::min(end, until);
+        return end >= begin && end - begin >= length;
+    };
+
+    if (depth == height) {
+        const auto *leaf = static_cast<const Leaf *>(node);
+        for (unsigned int i = leaf->count - 1; i > 0; --i) {
+            if (fits(leaf->ends[i - 1], leaf->starts[i])) {
+                return std::min(leaf->starts[i], until) - length;
+            }
+        }
+        return std::nullopt;
+    }
+
+    // mirrors search_gap_from, walking from the top down
+    auto *inner = static_cast<Inner *>(node);
+    bool child_is_leaf = depth + 1 == height;
+    for (unsigned int i = inner->count; i-- > 0;) {
+        if (i + 1 < inner->count && fits(inner->last_end[i], inner->first_start[i + 1])) {
+            return std::min(inner->first_start[i + 1], until) - length;
+        }
+        if (inner->max_gap[i] >= length &&
+            static_cast<unsigned long long>(inner->first_start[i]) + length <= until) {
+            auto found = search_gap_until(inner->children[i], depth + 1, length, until);
+            if (found) {
+                return found;
+            }
+            if (inner->last_end[i] <= until) {
+                refresh(inner, i, child_is_leaf);
+            }
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<unsigned int> IntervalBPlusTree::find_first_gap(unsigned int length, unsigned int from) {
+    if (from == 0) {
+        return find_first_gap(length);
+    }
+    if (from > capacity || capacity - from < length) {
+        return std::nullopt;
+    }
+    if (!root) {
+        return from;
+    }
+
+    Summary &summary = root_summary;
+    if (summary.first_start >= from && summary.first_start - from >= length) {
+        return from;
+    }
+    if (summary.max_gap >= length &&
+        static_cast<unsigned long long>(summary.last_end) >= static_cast<unsigned long long>(from) + length) {
+        auto found = search_gap_from(root, 0, length, from);
+        if (found) {
+            return found;
+        }
+        summary = summarize(root, height == 0);
+    }
+    unsigned int tail = std::max(summary.last_end, from);
+    if (capacity >= tail && capacity - tail >= length) {
+        return tail;
+    }
+    return std::nullopt;
+}
+
+std::optional<unsigned int> IntervalBPlusTree::find_last_gap(unsigned int length, unsigned int until) {
+    until = std::min(until, capacity);
+    if (until < length) {
+        return std::nullopt;
+    }
+    if (!root) {
+        return until - length;
+    }
+
+    Summary &summary = root_summary;
+    if (until >= summary.last_end && until - summary.last_end >= length) {
+        return until - length;
+    }
+    if (summary.max_gap >= length && static_cast<unsigned long long>(summary.first_start) + length <= until) {
+        auto found = search_gap_until(root, 0, length, until);
+        if (found) {
+            return found;
+        }
+        summary = summarize(root, height == 0);
+    }
+    unsigned int head = std::min(summary.first_start, until);
+    if (head >= length) {
+        return head - length;
+    }
+    return std::nullopt;
+}
@@ -0,0 +1,207 @@
+#ifndef INTERVAL_BPLUS_TREE_HPP
+#define INTERVAL_BPLUS_TREE_HPP
+
+#include <array>
+#include <climits>
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+/**
+ * @class IntervalBPlusTree
+ * @brief An ordered set of non-overlapping, non-empty intervals [start, end) inside [0, capacity), each with an id.
+ *
+ * A B+tree with a fanout of 16, so every key array of a node is exactly one 64 byte cache line and a lookup touches
+ * a handful of lines per level instead of one node per comparison like a red-black tree. Leaves hold the intervals
+ * and are linked in address order. Inner nodes keep, per child, the first start, the last end and a bound on the
+ * largest gap between two intervals inside the child, which makes finding the lowest gap of a given size O(log n).
+ *
+ * Unused key slots hold UINT_MAX, so a node is searched by comparing the key against all 16 slots without branches.
+ * An insert only shrinks the gap it lands in, so it leaves the gap bounds above it alone and updates a summary only
+ * where the new interval extends a child's range, stopping at the first one that stays the same. A gap search that
+ * enters a child whose bound turns out too high lowers that bound on the way back, which pays for the inserts that
+ * made it stale. The summary of the root is kept, so a search doesn't start by scanning the root.
+ */
+class IntervalBPlusTree {
+    struct Leaf;
+
+  public:
+    struct Entry {
+        unsigned int start;
+        unsigned int end;
+        int id;
+    };
+
+    /**
+     * @class Iterator
+     * @brief A bidirectional iterator over the intervals in address order, invalidated by insert and erase.
+     */
+    class Iterator {
+      public:
+        Entry operator*() const;
+        Iterator &operator++();
+        Iterator &operator--();
+        bool operator==(const Iterator &other) const;
+        bool operator!=(const Iterator &other) const;
+
+      private:
+        friend class IntervalBPlusTree;
+        Iterator(const IntervalBPlusTree *tree, const Leaf *leaf, unsigned int index);
+
+        const IntervalBPlusTree *tree;
+        /// nullptr for the past the end iterator.
+        const Leaf *leaf;
+        unsigned int index;
+    };
+
+    explicit IntervalBPlusTree(unsigned int capacity = 0);
+    IntervalBPlusTree(const IntervalBPlusTree &other);
+    IntervalBPlusTree(IntervalBPlusTree &&other) noexcept;
+    IntervalBPlusTree &operator=(const IntervalBPlusTree &other);
+    IntervalBPlusTree &operator=(IntervalBPlusTree &&other) noexcept;
+    ~IntervalBPlusTree();
+
+    /**
+     * @brief Adds [start, end) owned by id.
+     * @return False if an interval already starts at start. Overlaps with other intervals are not checked.
+     */
+    bool insert(unsigned int start, unsigned int end, int id);
+
+    /**
+     * @brief Removes the interval starting at start.
+     * @return False if no interval starts there.
+     */
+    bool erase(unsigned int start);
+
+    void clear();
+
+    /**
+     * @brief Replaces the contents with intervals sorted by start, in O(n) by building the levels bottom up.
+     *
+     * The intervals must not overlap, that isn't checked.
+     */
+    void assign_sorted(const std::vector<Entry> &entries);
+
+    /// the interval starting at start, or end().
+    Iterator find(unsigned int start) const;
+
+    /// the first interval starting at or after start, or end().
+    Iterator lower_bound(unsigned int start) const;
+
+    Iterator begin() const;
+    Iterator end() const;
+
+    std::size_t size() const;
+    bool empty() const;
+
+    /**
+     * @brief The lowest position where length units fit between the intervals, the array bounds included.
+     *
+     * The gap searches aren't const, they lower the gap bounds they find too high.
+     */
+    std::optional<unsigned int> find_first_gap(unsigned int length);
+
+    /**
+     * @brief Like find_first_gap, but the lowest position at or after from, in O(log n).
+     */
+    std::optional<unsigned int> find_first_gap(unsigned int length, unsigned int from);
+
+    /**
+     * @brief The highest position where length units fit between the intervals and end at or before until, in
+     * O(log n). The units are placed against the end of the gap they are in, or against until if it cuts the gap.
+     */
+    std::optional<unsigned int> find_last_gap(unsigned int length, unsigned int until = UINT_MAX);
+
+    /// the bytes held by all nodes, O(1).
+    std::size_t memory_bytes() const;
+
+  private:
+    static constexpr unsigned int fanout = 16;
+    /// a non-root node with fewer entries is merged with or refilled from a sibling.
+    static constexpr unsigned int min_fill = fanout / 4;
+
+    struct alignas(64) Leaf {
+        Leaf();
+
+        /// UINT_MAX past count.
+        std::array<unsigned int, fanout> starts;
+        std::array<unsigned int, fanout> ends;
+        std::array<int, fanout> ids;
+        unsigned int count = 0;
+        Leaf *prev = nullptr;
+        Leaf *next = nullptr;
+    };
+
+    /// children are leaves when the inner node sits right above the leaf level, inner nodes otherwise.
+    struct alignas(64) Inner {
+        Inner();
+
+        /// UINT_MAX past count.
+        std::array<unsigned int, fanout> first_start;
+        std::array<unsigned int, fanout> last_end;
+        /// at least the largest gap inside the child, exact after assign_sorted, erase and a search that lowered it.
+        std::array<unsigned int, fanout> max_gap;
+        std::array<void *, fanout> children;
+        unsigned int count = 0;
+    };
+
+    struct Summary {
+        unsigned int first_start;
+        unsigned int last_end;
+        unsigned int max_gap;
+    };
+
+    unsigned int capacity;
+
+    /// a Leaf if height is 0, an Inner otherwise, nullptr when the tree is empty.
+    void *root = nullptr;
+    /// the number of inner levels above the leaves.
+    unsigned int height = 0;
+    Leaf *first_leaf = nullptr;
+    Leaf *last_leaf = nullptr;
+    /// the summary of root, valid while root isn't nullptr.
+    Summary root_summary = {0, 0, 0};
+    std::size_t entry_count = 0;
+    /// live nodes of each kind, so memory_bytes doesn't have to walk the tree.
+    std::size_t leaf_count = 0;
+    std::size_t inner_count = 0;
+
+    static unsigned int count_of(const void *node, bool is_leaf);
+    static Summary summarize(const void *node, bool is_leaf);
+    /// returns whether the stored summary of the child changed.
+    static bool refresh(Inner *inner, unsigned int child, bool child_is_leaf);
+    /// the summary of a node after entry went into it, from the one before.
+    static Summary grown(const Summary &before, const Entry &entry);
+    /// fills the key slots from count on with UINT_MAX.
+    static void pad(std::array<unsigned int, fanout> &keys, unsigned int count);
+    /// the number of keys below key, over all slots.
+    static unsigned int count_below(const std::array<unsigned int, fanout> &keys, unsigned int key);
+
+    /// the index of the child whose range contains start, or would if start were inserted.
+    static unsigned int child_for(const Inner *inner, unsigned int start);
+
+    /// returns the new right sibling if node had to split, changed tells whether the summary of node may have too.
+    void *insert_into(void *node, unsigned int depth, const Entry &entry, bool &inserted, bool &changed);
+    Inner *insert_child(Inner *inner, unsigned int position, void *child, const Summary &summary);
+    Leaf *insert_entry(Leaf *leaf, unsigned int position, const Entry &entry);
+
+    bool erase_from(void *node, unsigned int depth, unsigned int start, bool &changed);
+    /// refills or merges the underfull child of inner with one of its siblings.
+    void rebalance(Inner *inner, unsigned int child, bool child_is_leaf);
+
+    void *clone(const void *node, unsigned int depth, Leaf *&previous_leaf);
+    void destroy(void *node, unsigned int depth);
+
+    /// follows the gap bounds from the root straight down, nullopt if one of them was too high.
+    std::optional<unsigned int> descend_to_gap(unsigned int length) const;
+
+    /// the searches below node, they only look at gaps between two intervals of node.
+    std::optional<unsigned int> search_gap(void *node, unsigned int depth, unsigned int length);
+    std::optional<unsigned int> search_gap_from(void *node, unsigned int depth, unsigned int length,
+                                                unsigned int from);
+    std::optional<unsigned int> search_gap_until(void *node, unsigned int depth, unsigned int length,
+                                                 unsigned int until);
+    const Leaf *leaf_for(unsigned int start) const;
+};
+
+#endif // INTERVAL_BPLUS_TREE_HPP
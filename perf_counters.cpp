@@ -0,0 +1,136 @@
+#include "perf_counters.hpp"
+#include <chrono>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace {
+#if defined(__linux__)
+/// glibc has no wrapper for perf_event_open.
+int open_event(std::uint64_t config, int group_fd) {
+    perf_event_attr attributes{};
+    attributes.size = sizeof(attributes);
+    attributes.type = PERF_TYPE_HARDWARE;
+    attributes.config = config;
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv = 1;
+    attributes.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    // only the leader starts disabled, the others follow it
+    attributes.disabled = group_fd == -1 ? 1 : 0;
+    return static_cast<int>(::syscall(SYS_perf_event_open, &attributes, 0, -1, group_fd, 0));
+}
+#endif
+} // namespace
+
+PerfCounters::PerfCounters(bool use_hardware) {
+#if defined(__linux__)
+    if (!use_hardware) {
+        return;
+    }
+
+    const std::array<std::uint64_t, event_count> configs = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                                            PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+    for (std::size_t event = 0; event < event_count; ++event) {
+        int fd = open_event(configs[event], descriptors[cycles]);
+        if (fd < 0) {
+            // without the leader there is no group to join
+            if (event == cycles) {
+                return;
+            }
+            continue;
+        }
+        descriptors[event] = fd;
+        read_order[opened_count++] = static_cast<Event>(event);
+    }
+#else
+    (void)use_hardware;
+#endif
+}
+
+PerfCounters::~PerfCounters() {
+#if defined(__linux__)
+    for (int fd : descriptors) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+#endif
+}
+
+bool PerfCounters::has_hardware_counters() const { return descriptors[cycles] >= 0; }
+
+const char *PerfCounters::fallback_source() {
+#if defined(__x86_64__) || defined(__i386__)
+    return "rdtsc";
+#else
+    return "ns";
+#endif
+}
+
+void PerfCounters::start() {
+    // read even with hardware counters, stop falls back to it if the group can't be read
+    fallback_start = read_fallback_clock();
+#if defined(__linux__)
+    if (has_hardware_counters()) {
+        ::ioctl(descriptors[cycles], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ::ioctl(descriptors[cycles], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+#endif
+}
+
+PerfCounters::Reading PerfCounters::stop() {
+    Reading reading;
+
+#if defined(__linux__)
+    if (has_hardware_counters()) {
+        ::ioctl(descriptors[cycles], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+        // the group reads as the event count, the time enabled and running, then one value per event
+        std::vector<std::uint64_t> buffer(3 + opened_count);
+        auto bytes = static_cast<ssize_t>(buffer.size() * sizeof(std::uint64_t));
+        // a group that never ran on the PMU counted nothing, which isn't the same as counting zero
+        if (::read(descriptors[cycles], buffer.data(), static_cast<std::size_t>(bytes)) == bytes && buffer[2] > 0) {
+            std::uint64_t enabled = buffer[1];
+            std::uint64_t running = buffer[2];
+            for (std::size_t i = 0; i < opened_count && i < buffer[0]; ++i) {
+                // the group was only on the PMU for part of the time, extrapolate to all of it
+                double value = static_cast<double>(buffer[3 + i]);
+                if (running < enabled) {
+                    value *= static_cast<double>(enabled) / static_cast<double>(running);
+                }
+                reading.values[read_order[i]] = static_cast<std::uint64_t>(value);
+                reading.available[read_order[i]] = true;
+            }
+            reading.hardware = true;
+            return reading;
+        }
+    }
+#endif
+
+    reading.values[cycles] = read_fallback_clock() - fallback_start;
+    reading.available[cycles] = true;
+    return reading;
+}
+
+std::uint64_t PerfCounters::read_fallback_clock() {
+#if defined(__x86_64__) || defined(__i386__)
+    // keep the measured work from being reordered around the read
+    _mm_lfence();
+    std::uint64_t ticks = __rdtsc();
+    _mm_lfence();
+    return ticks;
+#else
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+#endif
+}
@@ -0,0 +1,73 @@
+#ifndef PERF_COUNTERS_HPP
+#define PERF_COUNTERS_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @class PerfCounters
+ * @brief Counts cycles, instructions, cache misses and branch misses of the calling thread between start and stop.
+ *
+ * The hardware counters are opened as one group with perf_event_open, so they are scheduled onto the PMU together
+ * and cover exactly the same instructions, and only user space is counted. Counters the kernel refuses are left
+ * out, and if even the cycle counter can't be opened, as is common in containers and VMs, or the platform isn't
+ * Linux, cycles fall back to the time stamp counter (rdtsc) and the other events read as unavailable. The time
+ * stamp counter ticks at a constant reference rate rather than the core clock, so fallback cycles only compare
+ * with other fallback cycles. Off x86 the fallback counts steady clock nanoseconds instead.
+ *
+ * Starting and stopping takes a system call each, so measure batches of operations rather than single ones.
+ */
+class PerfCounters {
+  public:
+    enum Event : std::size_t { cycles, instructions, cache_misses, branch_misses, event_count };
+
+    /**
+     * @brief The events counted between start and stop, scaled up if the kernel had to multiplex the group.
+     */
+    struct Reading {
+        std::array<std::uint64_t, event_count> values{};
+        /// false for events that weren't counted, their value is 0.
+        std::array<bool, event_count> available{};
+        /// true if cycles came from the hardware counter rather than the fallback.
+        bool hardware = false;
+    };
+
+    /**
+     * @param use_hardware False to go straight to the fallback, for comparing against a run without counters.
+     */
+    explicit PerfCounters(bool use_hardware = true);
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+    ~PerfCounters();
+
+    /// true if at least the cycle counter is a hardware one.
+    bool has_hardware_counters() const;
+
+    /// what fallback cycles count, "rdtsc" for time stamp counter ticks and "ns" for steady clock nanoseconds.
+    static const char *fallback_source();
+
+    void start();
+
+    /**
+     * @brief The counts since the last start.
+     *
+     * If the group can't be read or was never scheduled onto the PMU, cycles come from the fallback clock, which
+     * start always reads, and the other events are unavailable.
+     */
+    Reading stop();
+
+  private:
+    /// the file descriptors of the opened events, -1 for the ones that aren't, the cycle counter leads the group.
+    std::array<int, event_count> descriptors{-1, -1, -1, -1};
+
+    /// the order the opened events appear in when the group is read.
+    std::array<Event, event_count> read_order{};
+    std::size_t opened_count = 0;
+
+    std::uint64_t fallback_start = 0;
+
+    static std::uint64_t read_fallback_clock();
+};
+
+#endif // PERF_COUNTERS_HPP
@@ -0,0 +1,157 @@
+#include "radix_interval_index.hpp"
+#include "container_memory.hpp"
+#include <algorithm>
+
+namespace {
+unsigned int lowest_bit(std::uint64_t word) {
+#if defined(__GNUC__)
+    return static_cast<unsigned int>(__builtin_ctzll(word));
+#else
+    unsigned int bit = 0;
+    while ((word & 1) == 0) {
+        word >>= 1;
+        bit++;
+    }
+    return bit;
+#endif
+}
+
+unsigned int highest_bit(std::uint64_t word) {
+#if defined(__GNUC__)
+    return 63 - static_cast<unsigned int>(__builtin_clzll(word));
+#else
+    unsigned int bit = 0;
+    while (word >>= 1) {
+        bit++;
+    }
+    return bit;
+#endif
+}
+} // namespace
+
+RadixIntervalIndex::RadixIntervalIndex(unsigned int universe) : universe(universe) {
+    std::size_t words = (static_cast<std::size_t>(universe) + 63) / 64;
+    do {
+        words = std::max<std::size_t>(words, 1);
+        levels.emplace_back(words, 0);
+        words = (words + 63) / 64;
+    } while (levels.back().size() > 1);
+}
+
+void RadixIntervalIndex::insert(unsigned int start, unsigned int end, int id) {
+    entries[start] = {end, id};
+
+    // set the bit on every level until one was already set, the levels above it are then set too
+    std::uint64_t position = start;
+    for (auto &level : levels) {
+        std::uint64_t &word = level[position / 64];
+        bool was_empty = word == 0;
+        word |= std::uint64_t(1) << (position % 64);
+        if (!was_empty) {
+            break;
+        }
+        position /= 64;
+    }
+}
+
+bool RadixIntervalIndex::erase(unsigned int start) {
+    if (!entries.erase(start)) {
+        return false;
+    }
+
+    // clear the bit on every level until a word stays non-zero
+    std::uint64_t position = start;
+    for (auto &level : levels) {
+        std::uint64_t &word = level[position / 64];
+        word &= ~(std::uint64_t(1) << (position % 64));
+        if (word != 0) {
+            break;
+        }
+        position /= 64;
+    }
+    return true;
+}
+
+void RadixIntervalIndex::clear() {
+    for (auto &level : levels) {
+        std::fill(level.begin(), level.end(), 0);
+    }
+    entries.clear();
+}
+
+std::optional<RadixIntervalIndex::Entry> RadixIntervalIndex::find(unsigned int start) const {
+    auto entry = entries.find(start);
+    if (entry == entries.end()) {
+        return std::nullopt;
+    }
+    return entry->second;
+}
+
+std::optional<std::uint64_t> RadixIntervalIndex::next_set(std::size_t level, std::uint64_t position) const {
+    const auto &words = levels[level];
+    if (position / 64 >= words.size()) {
+        return std::nullopt;
+    }
+
+    std::uint64_t word = words[position / 64] & (~std::uint64_t(0) << (position % 64));
+    if (word != 0) {
+        return position / 64 * 64 + lowest_bit(word);
+    }
+    if (level + 1 == levels.size()) {
+        return std::nullopt;
+    }
+
+    // the level above says which later word is the first non-zero one, its lowest bit is the answer
+    auto next_word = next_set(level + 1, position / 64 + 1);
+    if (!next_word) {
+        return std::nullopt;
+    }
+    return *next_word * 64 + lowest_bit(words[*next_word]);
+}
+
+std::optional<std::uint64_t> RadixIntervalIndex::previous_set(std::size_t level, std::uint64_t position) const {
+    const auto &words = levels[level];
+    std::uint64_t word = words[position / 64] & (~std::uint64_t(0) >> (63 - position % 64));
+    if (word != 0) {
+        return position / 64 * 64 + highest_bit(word);
+    }
+    if (level + 1 == levels.size() || position / 64 == 0) {
+        return std::nullopt;
+    }
+
+    auto previous_word = previous_set(level + 1, position / 64 - 1);
+    if (!previous_word) {
+        return std::nullopt;
+    }
+    return *previous_word * 64 + highest_bit(words[*previous_word]);
+}
+
+std::optional<unsigned int> RadixIntervalIndex::predecessor(unsigned int position) const {
+    if (universe == 0) {
+        return std::nullopt;
+    }
+    auto found = previous_set(0, std::min(position, universe - 1));
+    if (!found) {
+        return std::nullopt;
+    }
+    return static_cast<unsigned int>(*found);
+}
+
+std::optional<unsigned int> RadixIntervalIndex::successor(unsigned int position) const {
+    if (position >= universe) {
+        return std::nullopt;
+    }
+    auto found = next_set(0, position);
+    if (!found) {
+        return std::nullopt;
+    }
+    return static_cast<unsigned int>(*found);
+}
+
+std::size_t RadixIntervalIndex::memory_bytes() const {
+    std::size_t bytes = vector_bytes(levels) + hashed_container_bytes(entries);
+    for (const auto &level : levels) {
+        bytes += vector_bytes(level);
+    }
+    return bytes;
+}
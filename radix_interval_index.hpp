@@ -0,0 +1,63 @@
+#ifndef RADIX_INTERVAL_INDEX_HPP
+#define RADIX_INTERVAL_INDEX_HPP
+
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @class RadixIntervalIndex
+ * @brief Maps interval starts in [0, universe) to their end and id, with fast predecessor and successor queries.
+ *
+ * Starts are kept in a 64-ary hierarchy of bitsets, in the spirit of a van Emde Boas tree: the bottom level has one
+ * bit per position and every level above one bit per word below it. Predecessor and successor look at one word per
+ * level, that's log64(universe) words, at most 6 for a 32 bit universe, whatever the number of intervals. Ends and
+ * ids live in a hash table keyed by start.
+ *
+ * The bitsets cost about universe / 8 bytes no matter how many intervals there are, the hash table about 40 bytes
+ * per interval. An ordered set like IntervalBPlusTree pays only per interval, about 20 to 25 bytes, so this always
+ * needs more memory and trades it for lookups whose cost doesn't grow with the number of intervals. Compare the
+ * two with memory_bytes.
+ */
+class RadixIntervalIndex {
+  public:
+    struct Entry {
+        unsigned int end;
+        int id;
+    };
+
+    explicit RadixIntervalIndex(unsigned int universe);
+
+    /// adds or replaces the interval starting at start, which must be below the universe.
+    void insert(unsigned int start, unsigned int end, int id = 0);
+
+    /// returns false if no interval starts at start.
+    bool erase(unsigned int start);
+
+    void clear();
+
+    std::optional<Entry> find(unsigned int start) const;
+
+    /// the largest start at or before position.
+    std::optional<unsigned int> predecessor(unsigned int position) const;
+
+    /// the smallest start at or after position.
+    std::optional<unsigned int> successor(unsigned int position) const;
+
+    /// the bytes held by the bitsets and the hash table.
+    std::size_t memory_bytes() const;
+
+  private:
+    unsigned int universe;
+
+    /// levels[0] has a bit per position, levels[k + 1] a bit per non-zero word of levels[k], the last is one word.
+    std::vector<std::vector<std::uint64_t>> levels;
+
+    std::unordered_map<unsigned int, Entry> entries;
+
+    std::optional<std::uint64_t> next_set(std::size_t level, std::uint64_t position) const;
+    std::optional<std::uint64_t> previous_set(std::size_t level, std::uint64_t position) const;
+};
+
+#endif // RADIX_INTERVAL_INDEX_HPP
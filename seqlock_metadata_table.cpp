@@ -0,0 +1,197 @@
+#include "seqlock_metadata_table.hpp"
+
+SeqlockMetadataTable::Table::Table(std::size_t capacity) : mask(capacity - 1), slots(new Slot[capacity]) {}
+
+SeqlockMetadataTable::SeqlockMetadataTable() { rebuild(initial_capacity); }
+
+SeqlockMetadataTable::SeqlockMetadataTable(const SeqlockMetadataTable &other) { copy_from(other); }
+
+SeqlockMetadataTable::~SeqlockMetadataTable() { delete current.load(std::memory_order_relaxed); }
+
+SeqlockMetadataTable &SeqlockMetadataTable::operator=(const SeqlockMetadataTable &other) {
+    if (this != &other) {
+        copy_from(other);
+    }
+    return *this;
+}
+
+void SeqlockMetadataTable::copy_from(const SeqlockMetadataTable &other) {
+    const Table *source = other.current.load(std::memory_order_acquire);
+    std::size_t capacity = source ? source->mask + 1 : initial_capacity;
+
+    if (current.load(std::memory_order_relaxed)) {
+        clear();
+    }
+    rebuild(capacity);
+    for (std::size_t i = 0; source && i <= source->mask; ++i) {
+        SlotValue value = read_slot(source->slots[i]);
+        if (value.state == full) {
+            store(value.id, value.start, value.length);
+        }
+    }
+}
+
+std::size_t SeqlockMetadataTable::home_slot(int id, std::size_t mask) {
+    // fibonacci hashing, the high half of the product mixes every bit of the id
+    std::uint64_t hash = static_cast<std::uint64_t>(static_cast<std::uint32_t>(id)) * 0x9E3779B97F4A7C15ull;
+    return static_cast<std::size_t>(hash ^ (hash >> 32)) & mask;
+}
+
+SeqlockMetadataTable::SlotValue SeqlockMetadataTable::read_slot(const Slot &slot) {
+    for (;;) {
+        std::uint32_t before = slot.sequence.load(std::memory_order_acquire);
+        if (before & 1) {
+            continue;
+        }
+
+        SlotValue value;
+        value.state = slot.state.load(std::memory_order_relaxed);
+        value.id = slot.id.load(std::memory_order_relaxed);
+        value.start = slot.start.load(std::memory_order_relaxed);
+        value.length = slot.length.load(std::memory_order_relaxed);
+
+        // keeps the field loads above from being reordered after the second sequence load
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) == before) {
+            return value;
+        }
+    }
+}
+
+void SeqlockMetadataTable::write_slot(Slot &slot, SlotValue value) {
+    std::uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+    slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+    // keeps the field stores below from being reordered before the odd sequence number
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot.state.store(value.state, std::memory_order_relaxed);
+    slot.id.store(value.id, std::memory_order_relaxed);
+    slot.start.store(value.start, std::memory_order_relaxed);
+    slot.length.store(value.length, std::memory_order_relaxed);
+
+    slot.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+std::size_t SeqlockMetadataTable::memory_bytes() const {
+    const Table *table = current.load(std::memory_order_relaxed);
+    std::size_t bytes = table ? sizeof(Table) + (table->mask + 1) * sizeof(Slot) : 0;
+    return bytes + reclaimer.get_pending_bytes();
+}
+
+void SeqlockMetadataTable::rebuild(std::size_t min_capacity) {
+    std::size_t capacity = initial_capacity;
+    while (capacity < min_capacity || capacity / 2 < live_slots) {
+        capacity *= 2;
+    }
+
+    auto *table = new Table(capacity);
+    Table *previous = current.load(std::memory_order_relaxed);
+    for (std::size_t i = 0; previous && i <= previous->mask; ++i) {
+        const Slot &slot = previous->slots[i];
+        if (slot.state.load(std::memory_order_relaxed) != full) {
+            continue;
+        }
+
+        // the new table isn't visible to readers yet, so plain probing is enough
+        int id = slot.id.load(std::memory_order_relaxed);
+        std::size_t index = home_slot(id, table->mask);
+        while (table->slots[index].state.load(std::memory_order_relaxed) != empty) {
+            index = (index + 1) & table->mask;
+        }
+        write_slot(table->slots[index], {full, id, slot.start.load(std::memory_order_relaxed),
+                                         slot.length.load(std::memory_order_relaxed)});
+    }
+
+    used_slots = live_slots;
+    current.store(table, std::memory_order_release);
+    if (previous) {
+        reclaimer.retire(previous, sizeof(Table) + (previous->mask + 1) * sizeof(Slot));
+        reclaimer.collect();
+    }
+}
+
+void SeqlockMetadataTable::store(int id, unsigned int start, unsigned int length) {
+    Table *table = current.load(std::memory_order_relaxed);
+    std::size_t index = home_slot(id, table->mask);
+    std::optional<std::size_t> reusable;
+
+    for (;; index = (index + 1) & table->mask) {
+        Slot &slot = table->slots[index];
+        std::uint32_t state = slot.state.load(std::memory_order_relaxed);
+        if (state == empty) {
+            break;
+        }
+        if (state == tombstone) {
+            if (!reusable) {
+                reusable = index;
+            }
+            continue;
+        }
+        if (slot.id.load(std::memory_order_relaxed) == id) {
+            write_slot(slot, {full, id, start, length});
+            return;
+        }
+    }
+
+    // the id wasn't found before the first empty slot, so it goes into the first tombstone on the way there
+    if (reusable) {
+        write_slot(table->slots[*reusable], {full, id, start, length});
+        live_slots++;
+        return;
+    }
+
+    // filling an empty slot lengthens probe chains, keep at least a quarter of the slots empty
+    if ((used_slots + 1) * 4 > (table->mask + 1) * 3) {
+        rebuild(live_slots + 1 > (table->mask + 1) / 2 ? (table->mask + 1) * 2 : table->mask + 1);
+        store(id, start, length);
+        return;
+    }
+
+    write_slot(table->slots[index], {full, id, start, length});
+    live_slots++;
+    used_slots++;
+}
+
+void SeqlockMetadataTable::erase(int id) {
+    Table *table = current.load(std::memory_order_relaxed);
+    for (std::size_t index = home_slot(id, table->mask);; index = (index + 1) & table->mask) {
+        Slot &slot = table->slots[index];
+        std::uint32_t state = slot.state.load(std::memory_order_relaxed);
+        if (state == empty) {
+            return;
+        }
+        if (state == full && slot.id.load(std::memory_order_relaxed) == id) {
+            write_slot(slot, {tombstone, 0, 0, 0});
+            live_slots--;
+            return;
+        }
+    }
+}
+
+void SeqlockMetadataTable::clear() {
+    Table *table = current.load(std::memory_order_relaxed);
+    for (std::size_t i = 0; i <= table->mask; ++i) {
+        if (table->slots[i].state.load(std::memory_order_relaxed) != empty) {
+            write_slot(table->slots[i], {empty, 0, 0, 0});
+        }
+    }
+    live_slots = 0;
+    used_slots = 0;
+}
+
+std::optional<std::pair<unsigned int, unsigned int>> SeqlockMetadataTable::load(int id) const {
+    // the pinned epoch keeps the table alive even if the writer replaces it while it's being probed
+    auto guard = reclaimer.pin();
+    const Table *table = current.load(std::memory_order_acquire);
+
+    // every table keeps a quarter of its slots empty, so the probe always ends
+    for (std::size_t index = home_slot(id, table->mask);; index = (index + 1) & table->mask) {
+        SlotValue value = read_slot(table->slots[index]);
+        if (value.state == empty) {
+            return std::nullopt;
+        }
+        if (value.state == full && value.id == id) {
+            return std::make_pair(value.start, value.length);
+        }
+    }
+}
@@ -0,0 +1,104 @@
+#ifndef SEQLOCK_METADATA_TABLE_HPP
+#define SEQLOCK_METADATA_TABLE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "epoch_reclaimer.hpp"
+
+/**
+ * @class SeqlockMetadataTable
+ * @brief A hash table from region id to (start, length) that readers on other threads can query without locking.
+ *
+ * Meant for a single writer thread and any number of reader threads. Every slot carries its own sequence number,
+ * which the writer makes odd while it changes the slot and even again afterwards. A reader copies the slot and
+ * retries only if the sequence number was odd or changed in the meantime, so readers never block the writer or
+ * each other and only retry when they race a write to the very slot they are reading.
+ *
+ * The table uses open addressing with linear probing and never moves an entry while it's live, erased entries
+ * leave a tombstone. Growing or purging tombstones builds a new table and publishes it with a single pointer swap.
+ * Readers pin an epoch while they probe, so a replaced table is freed only once no reader can still be on it.
+ */
+class SeqlockMetadataTable {
+  public:
+    SeqlockMetadataTable();
+
+    /// copies the entries of other, must not run concurrently with a write to other.
+    SeqlockMetadataTable(const SeqlockMetadataTable &other);
+    SeqlockMetadataTable &operator=(const SeqlockMetadataTable &other);
+    ~SeqlockMetadataTable();
+
+    /**
+     * @brief Inserts an entry or overwrites the entry of an existing id. Writer thread only.
+     */
+    void store(int id, unsigned int start, unsigned int length);
+
+    /**
+     * @brief Removes the entry of an id if there is one. Writer thread only.
+     */
+    void erase(int id);
+
+    /**
+     * @brief Removes every entry. Writer thread only.
+     */
+    void clear();
+
+    /**
+     * @brief Looks up the (start, length) of an id. Safe to call from any thread at any time.
+     * @return The entry as it was at some point during the call, or std::nullopt if the id had none.
+     */
+    std::optional<std::pair<unsigned int, unsigned int>> load(int id) const;
+
+    /// the heap bytes of the current table and of the replaced ones still waiting to be freed. Writer thread only.
+    std::size_t memory_bytes() const;
+
+  private:
+    enum SlotState : std::uint32_t { empty, full, tombstone };
+
+    /// every field is atomic so a reader racing the writer reads stale values instead of invoking a data race.
+    struct Slot {
+        std::atomic<std::uint32_t> sequence{0};
+        std::atomic<std::uint32_t> state{empty};
+        std::atomic<int> id{0};
+        std::atomic<unsigned int> start{0};
+        std::atomic<unsigned int> length{0};
+    };
+
+    struct SlotValue {
+        std::uint32_t state;
+        int id;
+        unsigned int start;
+        unsigned int length;
+    };
+
+    struct Table {
+        explicit Table(std::size_t capacity);
+
+        std::size_t mask;
+        std::unique_ptr<Slot[]> slots;
+    };
+
+    static constexpr std::size_t initial_capacity = 16;
+
+    /// the table readers probe, owned by this. tables it replaced are retired into reclaimer.
+    std::atomic<Table *> current{nullptr};
+    mutable EpochReclaimer reclaimer;
+
+    /// full slots, and full plus tombstone slots, of the current table.
+    std::size_t live_slots = 0;
+    std::size_t used_slots = 0;
+
+    static std::size_t home_slot(int id, std::size_t mask);
+    static SlotValue read_slot(const Slot &slot);
+    static void write_slot(Slot &slot, SlotValue value);
+
+    /// publishes a fresh table sized for the live entries and copies them over, dropping every tombstone.
+    void rebuild(std::size_t min_capacity);
+    void copy_from(const SeqlockMetadataTable &other);
+};
+
+#endif // SEQLOCK_METADATA_TABLE_HPP
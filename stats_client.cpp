@@ -0,0 +1,417 @@
+#include "stats_client.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+/// just enough JSON for the documents StatsServer writes, numbers keep their text so 64 bit counters survive.
+struct JsonValue {
+    enum class Type { null, boolean, number, string, array, object };
+
+    Type type = Type::null;
+    bool boolean = false;
+    /// the digits of a number or the contents of a string.
+    std::string text;
+    std::vector<JsonValue> items;
+    std::vector<std::pair<std::string, JsonValue>> members;
+
+    const JsonValue *member(const std::string &key) const {
+        for (const auto &[name, value] : members) {
+            if (name == key) {
+                return &value;
+            }
+        }
+        return nullptr;
+    }
+};
+
+class JsonReader {
+  public:
+    explicit JsonReader(const std::string &text) : text(text) {}
+
+    std::optional<JsonValue> read_document() {
+        JsonValue value;
+        if (!read_value(value, 0)) {
+            return std::nullopt;
+        }
+        skip_whitespace();
+        if (position != text.size()) {
+            return std::nullopt;
+        }
+        return value;
+    }
+
+  private:
+    static constexpr int max_depth = 32;
+
+    const std::string &text;
+    std::size_t position = 0;
+
+    void skip_whitespace() {
+        while (position < text.size() && (text[position] == ' ' || text[position] == '\t' || text[position] == '\r' ||
+                                           text[position] == '\n')) {
+            position++;
+        }
+    }
+
+    bool consume(char expected) {
+        skip_whitespace();
+        if (position < text.size() && text[position] == expected) {
+            position++;
+            return true;
+        }
+        return false;
+    }
+
+    bool consume_word(const char *word) {
+        std::size_t length = std::strlen(word);
+        if (text.compare(position, length, word) != 0) {
+            return false;
+        }
+        position += length;
+        return true;
+    }
+
+    bool read_value(JsonValue &value, int depth) {
+        skip_whitespace();
+        if (position >= text.size() || depth > max_depth) {
+            return false;
+        }
+
+        char c = text[position];
+        if (c == '{') {
+            value.type = JsonValue::Type::object;
+            position++;
+            if (consume('}')) {
+                return true;
+            }
+            do {
+                std::string key;
+                JsonValue member;
+                skip_whitespace();
+                if (!read_string(key) || !consume(':') || !read_value(member, depth + 1)) {
+                    return false;
+                }
+                value.members.emplace_back(std::move(key), std::move(member));
+            } while (consume(','));
+            return consume('}');
+        }
+        if (c == '[') {
+            value.type = JsonValue::Type::array;
+            position++;
+            if (consume(']')) {
+                return true;
+            }
+            do {
+                value.items.emplace_back();
+                if (!read_value(value.items.back(), depth + 1)) {
+                    return false;
+                }
+            } while (consume(','));
+            return consume(']');
+        }
+        if (c == '"') {
+            value.type = JsonValue::Type::string;
+            return read_string(value.text);
+        }
+        if (c == 't' || c == 'f') {
+            value.type = JsonValue::Type::boolean;
+            value.boolean = c == 't';
+            return consume_word(value.boolean ? "true" : "false");
+        }
+        if (c == 'n') {
+            return consume_word("null");
+        }
+
+        value.type = JsonValue::Type::number;
+        std::size_t begin = position;
+        while (position < text.size() && text[position] != '\0' && std::strchr("+-0123456789.eE", text[position])) {
+            position++;
+        }
+        value.text = text.substr(begin, position - begin);
+        return !value.text.empty();
+    }
+
+    bool read_string(std::string &out) {
+        if (position >= text.size() || text[position] != '"') {
+            return false;
+        }
+        for (position++; position < text.size(); position++) {
+            char c = text[position];
+            if (c == '"') {
+                position++;
+                return true;
+            }
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (++position >= text.size()) {
+                return false;
+            }
+            switch (text[position]) {
+            case 'n':
+                out += '\n';
+                break;
+            case 't':
+                out += '\t';
+                break;
+            case 'r':
+                out += '\r';
+                break;
+            case 'b':
+                out += '\b';
+                break;
+            case 'f':
+                out += '\f';
+                break;
+            case 'u': {
+                if (position + 4 >= text.size()) {
+                    return false;
+                }
+                unsigned long code = std::strtoul(text.substr(position + 1, 4).c_str(), nullptr, 16);
+                position += 4;
+                // utf-8 for the basic multilingual plane, surrogate pairs aren't joined
+                if (code < 0x80) {
+                    out += static_cast<char>(code);
+                } else if (code < 0x800) {
+                    out += static_cast<char>(0xC0 | (code >> 6));
+                    out += static_cast<char>(0x80 | (code & 0x3F));
+                } else {
+                    out += static_cast<char>(0xE0 | (code >> 12));
+                    out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                    out += static_cast<char>(0x80 | (code & 0x3F));
+                }
+                break;
+            }
+            default:
+                out += text[position];
+            }
+        }
+        return false;
+    }
+};
+
+std::optional<TrackerRegistry::TrackerStats> read_tracker(const JsonValue &value) {
+    if (value.type != JsonValue::Type::object) {
+        return std::nullopt;
+    }
+
+    TrackerRegistry::TrackerStats tracker;
+    const JsonValue *name = value.member("name");
+    if (!name || name->type != JsonValue::Type::string) {
+        return std::nullopt;
+    }
+    tracker.name = name->text;
+
+    // missing counters read as 0, so older and newer servers stay readable
+    auto counter = [&value](const char *key) -> unsigned long long {
+        const JsonValue *member = value.member(key);
+        return member && member->type == JsonValue::Type::number ? std::strtoull(member->text.c_str(), nullptr, 10)
+                                                                 : 0;
+    };
+    tracker.regions = counter("regions");
+    tracker.total_elements = counter("size");
+    tracker.used_elements = counter("used");
+    tracker.reserved_elements = counter("reserved");
+    tracker.free_elements = counter("free");
+    tracker.largest_free_block = counter("largest_free");
+    tracker.operations.searches = counter("searches");
+    tracker.operations.failed_searches = counter("failed_searches");
+    tracker.operations.additions = counter("additions");
+    tracker.operations.failed_additions = counter("failed_additions");
+    tracker.operations.removals = counter("removals");
+    tracker.operations.expirations = counter("expirations");
+    tracker.operations.compactions = counter("compactions");
+
+    const JsonValue *fragmentation = value.member("fragmentation");
+    if (fragmentation && fragmentation->type == JsonValue::Type::number) {
+        tracker.fragmentation = std::strtod(fragmentation->text.c_str(), nullptr);
+    }
+    return tracker;
+}
+
+unsigned long long operation_total(const TrackerRegistry::TrackerStats &tracker) {
+    return tracker.operations.searches + tracker.operations.additions + tracker.operations.removals +
+           tracker.operations.expirations + tracker.operations.compactions;
+}
+
+/// the name cut to the column, with control characters that would break the table replaced.
+std::string display_name(const std::string &name) {
+    std::string shown = name.substr(0, 23);
+    for (char &c : shown) {
+        if (static_cast<unsigned char>(c) < 0x20) {
+            c = '?';
+        }
+    }
+    return shown;
+}
+
+double usage_of(const TrackerRegistry::TrackerStats &tracker) {
+    return tracker.total_elements == 0
+               ? 0.0
+               : 100.0 * static_cast<double>(tracker.used_elements) / static_cast<double>(tracker.total_elements);
+}
+} // namespace
+
+StatsClient::StatsClient(std::string socket_path) : socket_path(std::move(socket_path)) {}
+
+std::optional<std::string> StatsClient::fetch_json() const {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socket_path.empty() || socket_path.size() >= sizeof(address.sun_path)) {
+        return std::nullopt;
+    }
+    std::memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return std::nullopt;
+    }
+    if (::connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0) {
+        ::close(fd);
+        return std::nullopt;
+    }
+
+    // the server closes the connection after the document
+    std::string json;
+    char buffer[4096];
+    ssize_t received;
+    while ((received = ::recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+        json.append(buffer, static_cast<std::size_t>(received));
+    }
+    ::close(fd);
+
+    if (received < 0 || json.empty()) {
+        return std::nullopt;
+    }
+    return json;
+}
+
+std::optional<TrackerRegistry::AggregateStats> StatsClient::fetch() const {
+    auto json = fetch_json();
+    if (!json) {
+        return std::nullopt;
+    }
+    return parse(*json);
+}
+
+std::optional<TrackerRegistry::AggregateStats> StatsClient::parse(const std::string &json) {
+    auto document = JsonReader(json).read_document();
+    if (!document) {
+        return std::nullopt;
+    }
+
+    const JsonValue *trackers = document->member("trackers");
+    const JsonValue *total = document->member("total");
+    if (!trackers || trackers->type != JsonValue::Type::array || !total) {
+        return std::nullopt;
+    }
+
+    TrackerRegistry::AggregateStats stats;
+    for (const auto &item : trackers->items) {
+        auto tracker = read_tracker(item);
+        if (!tracker) {
+            return std::nullopt;
+        }
+        stats.trackers.push_back(std::move(*tracker));
+    }
+    auto total_stats = read_tracker(*total);
+    if (!total_stats) {
+        return std::nullopt;
+    }
+    stats.total = std::move(*total_stats);
+    return stats;
+}
+
+std::string StatsClient::render(const TrackerRegistry::AggregateStats &stats, std::size_t max_rows,
+                                const TrackerRegistry::AggregateStats *previous, double elapsed_seconds) {
+    std::map<std::string, unsigned long long> previous_operations;
+    std::map<std::string, unsigned int> name_counts;
+    if (previous && elapsed_seconds > 0.0) {
+        for (const auto &tracker : previous->trackers) {
+            previous_operations[tracker.name] = operation_total(tracker);
+            name_counts[tracker.name]++;
+        }
+        previous_operations[stats.total.name] = operation_total(previous->total);
+        name_counts[stats.total.name] = 1;
+    }
+
+    std::vector<const TrackerRegistry::TrackerStats *> rows;
+    for (const auto &tracker : stats.trackers) {
+        rows.push_back(&tracker);
+    }
+    std::stable_sort(rows.begin(), rows.end(),
+                     [](const auto *a, const auto *b) { return usage_of(*a) > usage_of(*b); });
+    if (rows.size() > max_rows) {
+        rows.resize(max_rows);
+    }
+    rows.push_back(&stats.total);
+
+    std::ostringstream os;
+    os << std::fixed << std::setprecision(1);
+    os << "trackers: " << stats.trackers.size() << "  regions: " << stats.total.regions
+       << "  used: " << stats.total.used_elements << " / " << stats.total.total_elements << " ("
+       << usage_of(stats.total) << "%)  fragmentation: " << std::setprecision(3) << stats.total.fragmentation
+       << std::setprecision(1) << "\n\n";
+
+    os << std::left << std::setw(24) << "NAME" << std::right << std::setw(10) << "REGIONS" << std::setw(8) << "USE%"
+       << std::setw(12) << "FREE" << std::setw(12) << "LARGEST" << std::setw(7) << "FRAG" << std::setw(10) << "OPS/S"
+       << std::setw(12) << "ADDED" << std::setw(12) << "REMOVED" << std::setw(10) << "FAILED" << "\n";
+    for (const auto *tracker : rows) {
+        std::string rate = "-";
+        auto before = previous_operations.find(tracker->name);
+        if (before != previous_operations.end() && name_counts[tracker->name] == 1 &&
+            operation_total(*tracker) >= before->second) {
+            std::ostringstream formatted;
+            formatted << std::fixed << std::setprecision(1)
+                      << static_cast<double>(operation_total(*tracker) - before->second) / elapsed_seconds;
+            rate = formatted.str();
+        }
+
+        os << std::left << std::setw(24) << display_name(tracker->name) << std::right << std::setw(10)
+           << tracker->regions << std::setw(8) << usage_of(*tracker) << std::setw(12) << tracker->free_elements
+           << std::setw(12) << tracker->largest_free_block << std::setw(7) << std::setprecision(3)
+           << tracker->fragmentation << std::setprecision(1) << std::setw(10) << rate << std::setw(12)
+           << tracker->operations.additions << std::setw(12) << tracker->operations.removals << std::setw(10)
+           << tracker->operations.failed_searches + tracker->operations.failed_additions << "\n";
+    }
+    return os.str();
+}
+
+bool StatsClient::run_top(std::ostream &out, std::chrono::milliseconds interval, std::size_t iterations,
+                          std::size_t max_rows) const {
+    std::optional<TrackerRegistry::AggregateStats> previous;
+    auto previous_time = std::chrono::steady_clock::now();
+
+    for (std::size_t drawn = 0; iterations == 0 || drawn < iterations; ++drawn) {
+        if (drawn > 0) {
+            std::this_thread::sleep_for(interval);
+        }
+
+        auto stats = fetch();
+        auto now = std::chrono::steady_clock::now();
+        if (!stats) {
+            out << "Could not read stats from " << socket_path << "\n";
+            return false;
+        }
+
+        double elapsed = std::chrono::duration<double>(now - previous_time).count();
+        // move the cursor home and clear the screen, then draw the new frame in one write
+        out << "\x1b[H\x1b[2J" << render(*stats, max_rows, previous ? &*previous : nullptr, elapsed);
+        out.flush();
+        previous = std::move(stats);
+        previous_time = now;
+    }
+    return true;
+}
@@ -0,0 +1,54 @@
+#ifndef STATS_CLIENT_HPP
+#define STATS_CLIENT_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <optional>
+#include <ostream>
+#include <string>
+
+#include "tracker_registry.hpp"
+
+/**
+ * @class StatsClient
+ * @brief Reads the stats a StatsServer serves and renders them as a top like view of all trackers.
+ *
+ * A command line tool only has to construct one with the socket path and call run_top.
+ */
+class StatsClient {
+  public:
+    explicit StatsClient(std::string socket_path);
+
+    /// the raw JSON document, or std::nullopt if nothing answers on the socket.
+    std::optional<std::string> fetch_json() const;
+
+    std::optional<TrackerRegistry::AggregateStats> fetch() const;
+
+    /**
+     * @brief Reads a document in the format of StatsServer::to_json back into stats.
+     * @return std::nullopt if it isn't valid JSON of that shape.
+     */
+    static std::optional<TrackerRegistry::AggregateStats> parse(const std::string &json);
+
+    /**
+     * @brief A table of the trackers, fullest first, with the total in the last row.
+     * @param max_rows The number of tracker rows to show at most, the total is always shown.
+     * @param previous Stats taken elapsed_seconds earlier, to show operations per second. Trackers are matched by
+     * name, so trackers sharing a name show no rate.
+     */
+    static std::string render(const TrackerRegistry::AggregateStats &stats, std::size_t max_rows,
+                              const TrackerRegistry::AggregateStats *previous = nullptr, double elapsed_seconds = 0.0);
+
+    /**
+     * @brief Redraws the table on out every interval, like top.
+     * @param iterations How many times to draw, 0 to draw until the server goes away.
+     * @return False if the server couldn't be reached on the last attempt.
+     */
+    bool run_top(std::ostream &out, std::chrono::milliseconds interval, std::size_t iterations = 0,
+                 std::size_t max_rows = 40) const;
+
+  private:
+    std::string socket_path;
+};
+
+#endif // STATS_CLIENT_HPP
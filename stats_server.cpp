@@ -0,0 +1,159 @@
+#include "stats_server.hpp"
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+std::string json_string(const std::string &value) {
+    std::ostringstream os;
+    os << '"';
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            os << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            os << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec;
+        } else {
+            os << c;
+        }
+    }
+    os << '"';
+    return os.str();
+}
+
+void write_tracker(std::ostringstream &os, const TrackerRegistry::TrackerStats &tracker) {
+    os << "{\"name\":" << json_string(tracker.name) << ",\"regions\":" << tracker.regions
+       << ",\"size\":" << tracker.total_elements << ",\"used\":" << tracker.used_elements
+       << ",\"reserved\":" << tracker.reserved_elements << ",\"free\":" << tracker.free_elements
+       << ",\"largest_free\":" << tracker.largest_free_block << ",\"fragmentation\":" << tracker.fragmentation
+       << ",\"searches\":" << tracker.operations.searches
+       << ",\"failed_searches\":" << tracker.operations.failed_searches
+       << ",\"additions\":" << tracker.operations.additions
+       << ",\"failed_additions\":" << tracker.operations.failed_additions
+       << ",\"removals\":" << tracker.operations.removals << ",\"expirations\":" << tracker.operations.expirations
+       << ",\"compactions\":" << tracker.operations.compactions << "}";
+}
+
+/// writes all of data unless the client goes away or stalls past the send timeout.
+void send_all(int fd, const std::string &data) {
+    std::size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t written = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (written <= 0) {
+            return;
+        }
+        sent += static_cast<std::size_t>(written);
+    }
+}
+} // namespace
+
+StatsServer::StatsServer(std::string socket_path, const TrackerRegistry &registry)
+    : socket_path(std::move(socket_path)), registry(registry) {}
+
+StatsServer::~StatsServer() { stop(); }
+
+bool StatsServer::start() {
+    if (is_running()) {
+        return false;
+    }
+
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socket_path.empty() || socket_path.size() >= sizeof(address.sun_path)) {
+        global_logger->info("Error: Stats socket path is empty or too long.");
+        return false;
+    }
+    std::memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+
+    listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0 || ::pipe(wake_pipe) != 0) {
+        global_logger->info("Error: Could not create the stats socket.");
+        close_descriptors();
+        return false;
+    }
+
+    // a previous process may have left its socket file behind
+    ::unlink(socket_path.c_str());
+    if (::bind(listen_fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 ||
+        ::listen(listen_fd, 16) != 0) {
+        global_logger->info("Error: Could not bind the stats socket to " + socket_path + ".");
+        close_descriptors();
+        ::unlink(socket_path.c_str());
+        return false;
+    }
+
+    thread = std::thread(&StatsServer::serve, this);
+    return true;
+}
+
+void StatsServer::stop() {
+    if (!is_running()) {
+        return;
+    }
+
+    char wake = 0;
+    while (::write(wake_pipe[1], &wake, 1) < 0 && errno == EINTR) {
+    }
+    thread.join();
+    close_descriptors();
+    ::unlink(socket_path.c_str());
+}
+
+bool StatsServer::is_running() const { return thread.joinable(); }
+
+void StatsServer::close_descriptors() {
+    for (int *fd : {&listen_fd, &wake_pipe[0], &wake_pipe[1]}) {
+        if (*fd >= 0) {
+            ::close(*fd);
+            *fd = -1;
+        }
+    }
+}
+
+std::string StatsServer::to_json(const TrackerRegistry::AggregateStats &stats) {
+    std::ostringstream os;
+    os << std::fixed << std::setprecision(4);
+    os << "{\"trackers\":[";
+    for (std::size_t i = 0; i < stats.trackers.size(); ++i) {
+        if (i > 0) {
+            os << ",";
+        }
+        write_tracker(os, stats.trackers[i]);
+    }
+    os << "],\"total\":";
+    write_tracker(os, stats.total);
+    os << "}";
+    return os.str();
+}
+
+void StatsServer::serve() {
+    for (;;) {
+        pollfd descriptors[2] = {{listen_fd, POLLIN, 0}, {wake_pipe[0], POLLIN, 0}};
+        if (::poll(descriptors, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        if (descriptors[1].revents != 0) {
+            return;
+        }
+
+        int client = ::accept(listen_fd, nullptr, nullptr);
+        if (client < 0) {
+            continue;
+        }
+
+        // a client that stops reading can hold the thread up for at most this long
+        timeval timeout{1, 0};
+        ::setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        send_all(client, to_json(registry.get_stats(false)) + "\n");
+        ::close(client);
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef STATS_SERVER_HPP
+#define STATS_SERVER_HPP
+
+#include <string>
+#include <thread>
+
+#include "tracker_registry.hpp"
+
+/**
+ * @class StatsServer
+ * @brief Serves the stats of a TrackerRegistry as JSON over a Unix domain socket, for on-box debugging.
+ *
+ * A background thread accepts connections and answers each one with a single JSON document followed by a newline,
+ * then closes it, so `socat - UNIX-CONNECT:<path>` is enough to read it and StatsClient renders it as a live view.
+ * The document is
+ *
+ *     {"trackers": [{"name": ..., "regions": ..., ...}, ...], "total": {...}}
+ *
+ * with the keys of TrackerRegistry::dump. It is built from the trackers' atomic counters only, so serving never
+ * takes a lock a tracker's own thread could be waiting on, apart from the registry lock that registering and
+ * destroying a tracker take.
+ */
+class StatsServer {
+  public:
+    explicit StatsServer(std::string socket_path, const TrackerRegistry &registry = TrackerRegistry::instance());
+    StatsServer(const StatsServer &) = delete;
+    StatsServer &operator=(const StatsServer &) = delete;
+
+    /// stops serving if it still is.
+    ~StatsServer();
+
+    /**
+     * @brief Binds the socket, replacing a stale file at its path, and starts serving on a background thread.
+     * @return False if it is already running or the socket can't be set up, in which case nothing is left behind.
+     */
+    bool start();
+
+    /// stops the thread and removes the socket file, does nothing if it isn't running.
+    void stop();
+
+    bool is_running() const;
+
+    /// the document sent to every client.
+    static std::string to_json(const TrackerRegistry::AggregateStats &stats);
+
+  private:
+    std::string socket_path;
+    const TrackerRegistry &registry;
+
+    int listen_fd = -1;
+    /// stop writes to the second end to wake the thread out of poll.
+    int wake_pipe[2] = {-1, -1};
+    std::thread thread;
+
+    void serve();
+    void close_descriptors();
+};
+
+#endif // STATS_SERVER_HPP
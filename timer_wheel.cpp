@@ -0,0 +1,182 @@
+#include "timer_wheel.hpp"
+#include "container_memory.hpp"
+#include <algorithm>
+
+namespace {
+unsigned int count_trailing_zeros(std::uint64_t value) {
+    unsigned int count = 0;
+    while ((value & 1) == 0) {
+        value >>= 1;
+        count++;
+    }
+    return count;
+}
+
+unsigned int highest_bit(std::uint64_t value) {
+    unsigned int bit = 0;
+    while (value >>= 1) {
+        bit++;
+    }
+    return bit;
+}
+} // namespace
+
+HierarchicalTimerWheel::HierarchicalTimerWheel(std::uint64_t now) : now(now) {}
+
+void HierarchicalTimerWheel::link(std::uint32_t timer, std::uint32_t bucket) {
+    Timer &t = timers[timer];
+    t.bucket = bucket;
+    t.prev = npos;
+    t.next = buckets[bucket];
+    if (t.next != npos) {
+        timers[t.next].prev = timer;
+    }
+    buckets[bucket] = timer;
+
+    if (bucket != overdue_bucket) {
+        occupied_slots[bucket / slots_per_level] |= std::uint64_t(1) << (bucket % slots_per_level);
+    }
+}
+
+void HierarchicalTimerWheel::unlink(std::uint32_t timer) {
+    Timer &t = timers[timer];
+    if (t.prev != npos) {
+        timers[t.prev].next = t.next;
+    } else {
+        buckets[t.bucket] = t.next;
+    }
+    if (t.next != npos) {
+        timers[t.next].prev = t.prev;
+    }
+
+    if (t.bucket != overdue_bucket && buckets[t.bucket] == npos) {
+        occupied_slots[t.bucket / slots_per_level] &= ~(std::uint64_t(1) << (t.bucket % slots_per_level));
+    }
+}
+
+void HierarchicalTimerWheel::release(std::uint32_t timer) {
+    timer_of_id.erase(timers[timer].id);
+    free_timers.push_back(timer);
+}
+
+void HierarchicalTimerWheel::place(std::uint32_t timer) {
+    std::uint64_t deadline = timers[timer].deadline;
+    if (deadline <= now) {
+        link(timer, overdue_bucket);
+        return;
+    }
+
+    // the level is the highest group of bits in which the deadline differs from now, so the timer only has to move
+    // once time enters its slot at that level
+    unsigned int level = highest_bit(deadline ^ now) / slot_bits;
+    unsigned int slot = static_cast<unsigned int>(deadline >> (level * slot_bits)) & (slots_per_level - 1);
+    link(timer, level * slots_per_level + slot);
+}
+
+void HierarchicalTimerWheel::schedule(int id, std::uint64_t deadline) {
+    if (buckets.empty()) {
+        buckets.assign(overdue_bucket + 1, npos);
+    }
+
+    auto existing = timer_of_id.find(id);
+    std::uint32_t timer;
+    if (existing != timer_of_id.end()) {
+        timer = existing->second;
+        unlink(timer);
+    } else if (!free_timers.empty()) {
+        timer = free_timers.back();
+        free_timers.pop_back();
+        timer_of_id[id] = timer;
+    } else {
+        timer = static_cast<std::uint32_t>(timers.size());
+        timers.push_back({});
+        timer_of_id[id] = timer;
+    }
+
+    timers[timer].id = id;
+    timers[timer].deadline = deadline;
+    place(timer);
+}
+
+bool HierarchicalTimerWheel::cancel(int id) {
+    auto existing = timer_of_id.find(id);
+    if (existing == timer_of_id.end()) {
+        return false;
+    }
+    unlink(existing->second);
+    release(existing->second);
+    return true;
+}
+
+std::vector<int> HierarchicalTimerWheel::advance(std::uint64_t target) {
+    std::vector<int> expired;
+    if (buckets.empty()) {
+        now = std::max(now, target);
+        return expired;
+    }
+
+    auto expire_bucket = [&](std::uint32_t bucket) {
+        while (buckets[bucket] != npos) {
+            std::uint32_t timer = buckets[bucket];
+            unlink(timer);
+            if (timers[timer].deadline <= now) {
+                expired.push_back(timers[timer].id);
+                release(timer);
+            } else {
+                place(timer);
+            }
+        }
+    };
+
+    expire_bucket(overdue_bucket);
+
+    while (now < target) {
+        // the lowest level with an occupied slot after the current one holds the next event, every timer on a
+        // lower level would be due before the end of the current slot of the level above it
+        std::optional<std::uint64_t> next;
+        unsigned int next_level = 0;
+        for (unsigned int level = 0; level < levels && !next; ++level) {
+            unsigned int shift = level * slot_bits;
+            unsigned int current_slot = static_cast<unsigned int>(now >> shift) & (slots_per_level - 1);
+            std::uint64_t later = current_slot == slots_per_level - 1 ? 0 : ~std::uint64_t(0) << (current_slot + 1);
+            std::uint64_t candidates = occupied_slots[level] & later;
+            if (candidates == 0) {
+                continue;
+            }
+
+            unsigned int parent_shift = shift + slot_bits;
+            std::uint64_t parent_start = parent_shift >= 64 ? 0 : (now >> parent_shift) << parent_shift;
+            next = parent_start | (std::uint64_t(count_trailing_zeros(candidates)) << shift);
+            next_level = level;
+        }
+
+        if (!next || *next > target) {
+            now = target;
+            break;
+        }
+
+        // entering the slot either expires its timers or cascades them down to finer levels
+        now = *next;
+        unsigned int slot = static_cast<unsigned int>(now >> (next_level * slot_bits)) & (slots_per_level - 1);
+        expire_bucket(next_level * slots_per_level + slot);
+    }
+
+    return expired;
+}
+
+std::optional<std::uint64_t> HierarchicalTimerWheel::get_deadline(int id) const {
+    auto existing = timer_of_id.find(id);
+    if (existing == timer_of_id.end()) {
+        return std::nullopt;
+    }
+    return timers[existing->second].deadline;
+}
+
+std::uint64_t HierarchicalTimerWheel::get_now() const { return now; }
+
+std::size_t HierarchicalTimerWheel::size() const { return timer_of_id.size(); }
+
+std::size_t HierarchicalTimerWheel::memory_bytes() const {
+    return vector_bytes(timers) + vector_bytes(free_timers) + hashed_container_bytes(timer_of_id) +
+           vector_bytes(buckets);
+}
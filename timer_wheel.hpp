@@ -0,0 +1,88 @@
+#ifndef TIMER_WHEEL_HPP
+#define TIMER_WHEEL_HPP
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @class HierarchicalTimerWheel
+ * @brief Tracks a deadline per integer id and reports the ids whose deadlines have passed.
+ *
+ * Deadlines are placed on one of several wheels of 64 slots each, where every wheel is 64 times coarser than the
+ * one below it, enough to cover the full 64 bit time range. Scheduling and cancelling are O(1). Advancing jumps
+ * straight to the next occupied slot using a per wheel occupancy mask instead of stepping through every tick, so it
+ * costs O(levels) per expired or cascaded timer and nothing for idle time.
+ *
+ * Time is measured in whatever unit the caller uses, it only has to be monotonic.
+ */
+class HierarchicalTimerWheel {
+  public:
+    explicit HierarchicalTimerWheel(std::uint64_t now = 0);
+
+    /**
+     * @brief Sets or replaces the deadline of an id. A deadline that has already passed expires on the next advance.
+     */
+    void schedule(int id, std::uint64_t deadline);
+
+    /**
+     * @brief Forgets the deadline of an id.
+     * @return True if the id had a deadline.
+     */
+    bool cancel(int id);
+
+    /**
+     * @brief Moves time forward and collects every id whose deadline is at or before now.
+     * @param now The new current time, a value before the current time is ignored.
+     * @return The expired ids, their deadlines are forgotten.
+     */
+    std::vector<int> advance(std::uint64_t now);
+
+    std::optional<std::uint64_t> get_deadline(int id) const;
+
+    std::uint64_t get_now() const;
+
+    /// the number of ids with a deadline.
+    std::size_t size() const;
+
+    /// the heap bytes held by the timers, their free list, the id index and the buckets.
+    std::size_t memory_bytes() const;
+
+  private:
+    static constexpr unsigned int slot_bits = 6;
+    static constexpr unsigned int slots_per_level = 1u << slot_bits;
+    static constexpr unsigned int levels = (64 + slot_bits - 1) / slot_bits;
+    /// the bucket holding deadlines that had already passed when they were scheduled.
+    static constexpr unsigned int overdue_bucket = levels * slots_per_level;
+    static constexpr std::uint32_t npos = UINT32_MAX;
+
+    struct Timer {
+        int id;
+        std::uint64_t deadline;
+        std::uint32_t bucket;
+        std::uint32_t prev;
+        std::uint32_t next;
+    };
+
+    std::uint64_t now;
+
+    /// timers are linked into their bucket by index, so the wheel stays valid when it is copied.
+    std::vector<Timer> timers;
+    std::vector<std::uint32_t> free_timers;
+    std::unordered_map<int, std::uint32_t> timer_of_id;
+
+    /// the first timer of each bucket, allocated on the first schedule.
+    std::vector<std::uint32_t> buckets;
+
+    /// bit s of occupied_slots[level] is set when slot s of that level is non-empty.
+    std::array<std::uint64_t, levels> occupied_slots{};
+
+    void place(std::uint32_t timer);
+    void link(std::uint32_t timer, std::uint32_t bucket);
+    void unlink(std::uint32_t timer);
+    void release(std::uint32_t timer);
+};
+
+#endif // TIMER_WHEEL_HPP
@@ -0,0 +1,496 @@
+#include "tracker_benchmark.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <thread>
+
+TrackerBenchmark::TrackerBenchmark(unsigned int array_size, unsigned int seed, bool use_hardware)
+    : array_size(array_size), seed(seed), counters(use_hardware) {}
+
+FixedSizeArrayTracker TrackerBenchmark::make_fragmented_tracker() const {
+    FixedSizeArrayTracker tracker(array_size);
+    std::mt19937 generator(seed);
+    std::uniform_int_distribution<unsigned int> length(1, 16);
+
+    // regions are placed back to back, which needs no search, then every other one is freed
+    int regions = 0;
+    for (unsigned int position = 0;;) {
+        unsigned int next_length = length(generator);
+        if (static_cast<unsigned long long>(position) + next_length > array_size) {
+            break;
+        }
+        tracker.add_metadata(regions++, position, next_length);
+        position += next_length;
+    }
+    for (int id = 0; id < regions; id += 2) {
+        tracker.remove_metadata(id);
+    }
+    return tracker;
+}
+
+std::vector<FixedSizeArrayTracker::Placement>
+TrackerBenchmark::plan_placements(const FixedSizeArrayTracker &tracker, std::size_t count) const {
+    FixedSizeArrayTracker scratch = tracker;
+    std::mt19937 generator(seed + 1);
+    std::uniform_int_distribution<unsigned int> length(1, 16);
+
+    // the layout only uses ids below array_size, and the holes it leaves are as long as its regions
+    std::vector<FixedSizeArrayTracker::Placement> placements;
+    for (std::size_t i = 0; i < count; ++i) {
+        unsigned int next_length = length(generator);
+        auto start = scratch.find_contiguous_space(next_length);
+        if (!start) {
+            // smaller lengths may still fit
+            continue;
+        }
+        int id = static_cast<int>(array_size + i);
+        scratch.add_metadata(id, *start, next_length);
+        placements.push_back({id, *start, next_length});
+    }
+    return placements;
+}
+
+template <typename Layout, typename Body>
+TrackerBenchmark::Result TrackerBenchmark::measure(const std::string &operation, const Layout &layout,
+                                                   std::size_t operations, Body body) {
+    Layout warmup = layout;
+    body(warmup);
+
+    Layout measured = layout;
+    counters.start();
+    body(measured);
+    PerfCounters::Reading reading = counters.stop();
+
+    Result result;
+    result.operation = operation;
+    result.operations = operations;
+    result.available = reading.available;
+    result.hardware = reading.hardware;
+    for (std::size_t event = 0; event < PerfCounters::event_count; ++event) {
+        result.per_operation[event] =
+            operations == 0 ? 0.0 : static_cast<double>(reading.values[event]) / static_cast<double>(operations);
+    }
+    return result;
+}
+
+template <typename Work> double TrackerBenchmark::run_threads(unsigned int threads, Work &work) {
+    std::atomic<unsigned int> ready{0};
+    std::atomic<bool> go{false};
+    std::vector<std::thread> workers;
+    workers.reserve(threads);
+    for (unsigned int thread = 0; thread < threads; ++thread) {
+        workers.emplace_back([&ready, &go, &work, thread] {
+            ready.fetch_add(1, std::memory_order_acq_rel);
+            while (!go.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            work(thread);
+        });
+    }
+
+    // the clock starts once every thread exists, so creating them isn't timed
+    while (ready.load(std::memory_order_acquire) < threads) {
+        std::this_thread::yield();
+    }
+    auto began = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - began).count();
+}
+
+template <typename State, typename MakeWork>
+TrackerBenchmark::ScalingResult TrackerBenchmark::measure_threads(const std::string &operation,
+                                                                  const std::string &backend, const State &layout,
+                                                                  unsigned int threads, MakeWork make_work) {
+    std::vector<std::size_t> done(threads);
+    auto run = [&done, &make_work](State &state) {
+        auto work = make_work(state);
+        auto counted = [&done, &work](unsigned int thread) { done[thread] = work(thread); };
+        return run_threads(static_cast<unsigned int>(done.size()), counted);
+    };
+
+    State warmup = layout;
+    run(warmup);
+    State state = layout;
+    double elapsed = run(state);
+
+    ScalingResult result;
+    result.operation = operation;
+    result.backend = backend;
+    result.threads = threads;
+    result.operations = std::accumulate(done.begin(), done.end(), std::size_t{0});
+    result.nanoseconds_per_operation = result.operations == 0 ? 0.0 : elapsed / static_cast<double>(result.operations);
+    return result;
+}
+
+TrackerBenchmark::Result TrackerBenchmark::measure_find_contiguous_space(std::size_t operations) {
+    std::mt19937 generator(seed + 2);
+    std::uniform_int_distribution<unsigned int> length(1, 16);
+    std::vector<unsigned int> lengths(operations);
+    for (auto &next_length : lengths) {
+        next_length = length(generator);
+    }
+
+    return measure("find_contiguous_space", make_fragmented_tracker(), operations,
+                   [&lengths](FixedSizeArrayTracker &tracker) {
+                       for (unsigned int next_length : lengths) {
+                           tracker.find_contiguous_space(next_length);
+                       }
+                   });
+}
+
+TrackerBenchmark::Result TrackerBenchmark::measure_add_metadata(std::size_t operations) {
+    FixedSizeArrayTracker layout = make_fragmented_tracker();
+    auto placements = plan_placements(layout, operations);
+
+    return measure("add_metadata", layout, placements.size(), [&placements](FixedSizeArrayTracker &tracker) {
+        for (const auto &placement : placements) {
+            tracker.add_metadata(placement.id, placement.start, placement.length);
+        }
+    });
+}
+
+TrackerBenchmark::Result TrackerBenchmark::measure_remove_metadata(std::size_t operations) {
+    FixedSizeArrayTracker layout = make_fragmented_tracker();
+    auto placements = plan_placements(layout, operations);
+    std::vector<int> ids;
+    for (const auto &placement : placements) {
+        layout.add_metadata(placement.id, placement.start, placement.length);
+        ids.push_back(placement.id);
+    }
+    std::shuffle(ids.begin(), ids.end(), std::mt19937(seed + 3));
+
+    return measure("remove_metadata", layout, ids.size(), [&ids](FixedSizeArrayTracker &tracker) {
+        for (int id : ids) {
+            tracker.remove_metadata(id);
+        }
+    });
+}
+
+std::vector<TrackerBenchmark::Result> TrackerBenchmark::measure_interval_indexes(std::size_t operations) {
+    FixedSizeArrayTracker layout = make_fragmented_tracker();
+    std::vector<IntervalBPlusTree::Entry> entries;
+    for (const auto &[id, range] : layout.get_all_metadata()) {
+        entries.push_back({range.first, range.first + range.second, id});
+    }
+    std::sort(entries.begin(), entries.end(),
+              [](const IntervalBPlusTree::Entry &a, const IntervalBPlusTree::Entry &b) { return a.start < b.start; });
+
+    using IntervalSet = std::set<std::pair<unsigned int, unsigned int>>;
+    IntervalBPlusTree tree(array_size);
+    tree.assign_sorted(entries);
+    IntervalSet set;
+    for (const auto &entry : entries) {
+        set.emplace_hint(set.end(), entry.start, entry.end);
+    }
+
+    std::mt19937 generator(seed + 6);
+    std::uniform_int_distribution<std::size_t> index(0, entries.size() - 1);
+    std::uniform_int_distribution<unsigned int> length(1, 16);
+    std::vector<unsigned int> starts(operations);
+    std::vector<unsigned int> lengths(operations);
+    for (std::size_t i = 0; i < operations; ++i) {
+        starts[i] = entries[index(generator)].start;
+        lengths[i] = length(generator);
+    }
+    auto placements = plan_placements(layout, operations);
+
+    auto set_first_fit = [this](const IntervalSet &intervals, unsigned int next_length) -> std::optional<unsigned int> {
+        unsigned int gap_start = 0;
+        for (const auto &[start, end] : intervals) {
+            if (start - gap_start >= next_length) {
+                return gap_start;
+            }
+            gap_start = end;
+        }
+        return array_size - gap_start >= next_length ? std::optional<unsigned int>(gap_start) : std::nullopt;
+    };
+
+    // every batch stores the sum of its results here, so its lookups and searches can't be optimized away
+    volatile unsigned long long sink = 0;
+
+    std::vector<Result> results;
+    results.push_back(measure("bplus_tree find", tree, operations, [&](IntervalBPlusTree &intervals) {
+        unsigned long long sum = 0;
+        for (unsigned int start : starts) {
+            sum += (*intervals.find(start)).end;
+        }
+        sink = sum;
+    }));
+    results.push_back(measure("std::set find", set, operations, [&](IntervalSet &intervals) {
+        unsigned long long sum = 0;
+        for (unsigned int start : starts) {
+            sum += intervals.lower_bound({start, 0})->second;
+        }
+        sink = sum;
+    }));
+    results.push_back(measure("bplus_tree insert", tree, placements.size(), [&](IntervalBPlusTree &intervals) {
+        for (const auto &placement : placements) {
+            intervals.insert(placement.start, placement.start + placement.length, placement.id);
+        }
+    }));
+    results.push_back(measure("std::set insert", set, placements.size(), [&](IntervalSet &intervals) {
+        for (const auto &placement : placements) {
+            intervals.emplace(placement.start, placement.start + placement.length);
+        }
+    }));
+    results.push_back(measure("bplus_tree first_fit", tree, operations, [&](IntervalBPlusTree &intervals) {
+        unsigned long long sum = 0;
+        for (unsigned int next_length : lengths) {
+            sum += intervals.find_first_gap(next_length).value_or(0);
+        }
+        sink = sum;
+    }));
+    results.push_back(measure("std::set first_fit", set, operations, [&](IntervalSet &intervals) {
+        unsigned long long sum = 0;
+        for (unsigned int next_length : lengths) {
+            sum += set_first_fit(intervals, next_length).value_or(0);
+        }
+        sink = sum;
+    }));
+
+    // the layout's holes are at most 16 long, so these only fit past the last region
+    results.push_back(measure("bplus_tree past_holes", tree, operations, [&](IntervalBPlusTree &intervals) {
+        unsigned long long sum = 0;
+        for (std::size_t i = 0; i < operations; ++i) {
+            sum += intervals.find_first_gap(17).value_or(0);
+        }
+        sink = sum;
+    }));
+    results.push_back(measure("std::set past_holes", set, operations, [&](IntervalSet &intervals) {
+        unsigned long long sum = 0;
+        for (std::size_t i = 0; i < operations; ++i) {
+            sum += set_first_fit(intervals, 17).value_or(0);
+        }
+        sink = sum;
+    }));
+    return results;
+}
+
+std::vector<TrackerBenchmark::ScalingResult>
+TrackerBenchmark::measure_thread_scaling(std::size_t operations_per_thread, unsigned int max_threads) {
+    FixedSizeArrayTracker tracker_layout = make_fragmented_tracker();
+    ConcurrentIntervalSkipList list_layout(array_size);
+    for (const auto &[id, range] : tracker_layout.get_all_metadata()) {
+        list_layout.insert(range.first, range.first + range.second, id);
+    }
+    list_layout.tighten_gap_hints();
+
+    // every thread allocates the same lengths on both backends, ids above the layout's and distinct per thread
+    std::vector<std::vector<unsigned int>> lengths(max_threads);
+    for (unsigned int thread = 0; thread < max_threads; ++thread) {
+        std::mt19937 generator(seed + 4 + thread);
+        std::uniform_int_distribution<unsigned int> length(1, 16);
+        lengths[thread].resize(operations_per_thread / 2);
+        for (auto &next_length : lengths[thread]) {
+            next_length = length(generator);
+        }
+    }
+    auto first_id = [this, operations_per_thread](unsigned int thread) {
+        return static_cast<int>(array_size + thread * operations_per_thread);
+    };
+    constexpr std::size_t held_regions = 8;
+
+    std::vector<ScalingResult> results;
+    for (unsigned int threads = 1; threads <= max_threads; threads *= 2) {
+        results.push_back(measure_threads(
+            "allocate_remove", "skip list", list_layout, threads, [&](ConcurrentIntervalSkipList &list) {
+                return [&list, &lengths, &first_id](unsigned int thread) {
+                    std::deque<unsigned int> held;
+                    std::size_t operations = 0;
+                    int id = first_id(thread);
+                    for (unsigned int next_length : lengths[thread]) {
+                        auto start = list.allocate(next_length, id++);
+                        operations++;
+                        if (start) {
+                            held.push_back(*start);
+                        }
+                        if (held.size() > held_regions) {
+                            list.remove(held.front());
+                            held.pop_front();
+                            operations++;
+                        }
+                    }
+                    return operations;
+                };
+            }));
+
+        results.push_back(measure_threads(
+            "allocate_remove", "mutex tracker", tracker_layout, threads, [&](FixedSizeArrayTracker &tracker) {
+                auto mutex = std::make_shared<std::mutex>();
+                return [&tracker, mutex, &lengths, &first_id](unsigned int thread) {
+                    std::deque<int> held;
+                    std::size_t operations = 0;
+                    int id = first_id(thread);
+                    for (unsigned int next_length : lengths[thread]) {
+                        std::lock_guard<std::mutex> lock(*mutex);
+                        if (tracker.allocate(id, next_length)) {
+                            held.push_back(id);
+                        }
+                        id++;
+                        operations++;
+                        if (held.size() > held_regions) {
+                            tracker.remove_metadata(held.front());
+                            held.pop_front();
+                            operations++;
+                        }
+                    }
+                    return operations;
+                };
+            }));
+    }
+    return results;
+}
+
+std::vector<TrackerBenchmark::ScalingResult>
+TrackerBenchmark::measure_reader_scaling(std::size_t operations_per_thread, unsigned int max_readers) {
+    FixedSizeArrayTracker seqlock_layout = make_fragmented_tracker();
+    seqlock_layout.set_concurrent_reads(true);
+    FixedSizeArrayTracker mutex_layout = make_fragmented_tracker();
+
+    // the layout keeps the odd ids, readers look them up and the writer cycles through them
+    std::vector<int> ids;
+    for (const auto &[id, range] : mutex_layout.get_all_metadata()) {
+        ids.push_back(id);
+    }
+    std::sort(ids.begin(), ids.end());
+    std::vector<std::vector<int>> lookups(max_readers);
+    for (unsigned int reader = 0; reader < max_readers; ++reader) {
+        std::mt19937 generator(seed + 5 + reader);
+        std::uniform_int_distribution<std::size_t> index(0, ids.size() - 1);
+        lookups[reader].resize(operations_per_thread);
+        for (auto &id : lookups[reader]) {
+            id = ids[index(generator)];
+        }
+    }
+
+    // thread 0 writes, the others read
+    auto writer = [&ids](FixedSizeArrayTracker &tracker, std::mutex *mutex, const std::atomic<unsigned int> &reading) {
+        for (std::size_t next = 0; reading.load(std::memory_order_acquire) > 0; next = (next + 1) % ids.size()) {
+            std::unique_lock<std::mutex> lock;
+            if (mutex) {
+                lock = std::unique_lock<std::mutex>(*mutex);
+            }
+            auto range = tracker.get_metadata(ids[next]);
+            tracker.remove_metadata(ids[next]);
+            tracker.add_metadata(ids[next], range->first, range->second);
+        }
+    };
+
+    std::vector<ScalingResult> results;
+    for (unsigned int readers = 1; readers <= max_readers; readers *= 2) {
+        results.push_back(measure_threads(
+            "get_metadata", "seqlock", seqlock_layout, readers + 1, [&](FixedSizeArrayTracker &tracker) {
+                auto reading = std::make_shared<std::atomic<unsigned int>>(readers);
+                return [&tracker, reading, &lookups, &writer](unsigned int thread) -> std::size_t {
+                    if (thread == 0) {
+                        writer(tracker, nullptr, *reading);
+                        return 0;
+                    }
+                    for (int id : lookups[thread - 1]) {
+                        tracker.get_metadata_concurrent(id);
+                    }
+                    reading->fetch_sub(1, std::memory_order_acq_rel);
+                    return lookups[thread - 1].size();
+                };
+            }));
+        results.back().threads = readers;
+
+        results.push_back(measure_threads(
+            "get_metadata", "mutex", mutex_layout, readers + 1, [&](FixedSizeArrayTracker &tracker) {
+                auto reading = std::make_shared<std::atomic<unsigned int>>(readers);
+                auto mutex = std::make_shared<std::mutex>();
+                return [&tracker, reading, mutex, &lookups, &writer](unsigned int thread) -> std::size_t {
+                    if (thread == 0) {
+                        writer(tracker, mutex.get(), *reading);
+                        return 0;
+                    }
+                    for (int id : lookups[thread - 1]) {
+                        std::lock_guard<std::mutex> lock(*mutex);
+                        tracker.get_metadata(id);
+                    }
+                    reading->fetch_sub(1, std::memory_order_acq_rel);
+                    return lookups[thread - 1].size();
+                };
+            }));
+        results.back().threads = readers;
+    }
+    return results;
+}
+
+std::vector<TrackerBenchmark::Result> TrackerBenchmark::run_all(std::size_t operations) {
+    std::vector<Result> results = {measure_find_contiguous_space(operations), measure_add_metadata(operations),
+                                   measure_remove_metadata(operations)};
+    auto indexes = measure_interval_indexes(operations);
+    results.insert(results.end(), indexes.begin(), indexes.end());
+    return results;
+}
+
+std::vector<TrackerBenchmark::ScalingResult> TrackerBenchmark::run_scaling(std::size_t operations_per_thread,
+                                                                           unsigned int max_threads) {
+    auto results = measure_thread_scaling(operations_per_thread, max_threads);
+    auto readers = measure_reader_scaling(operations_per_thread, max_threads);
+    results.insert(results.end(), readers.begin(), readers.end());
+    return results;
+}
+
+std::string TrackerBenchmark::format(const std::vector<Result> &results) {
+    std::ostringstream os;
+    os << std::left << std::setw(24) << "OPERATION" << std::right << std::setw(10) << "OPS" << std::setw(12)
+       << "CYCLES/OP" << std::setw(12) << "INSTR/OP" << std::setw(8) << "IPC" << std::setw(14) << "CACHE MISS/OP"
+       << std::setw(15) << "BRANCH MISS/OP" << std::setw(8) << "SOURCE" << "\n";
+
+    os << std::fixed << std::setprecision(2);
+    for (const auto &result : results) {
+        auto column = [&os, &result](PerfCounters::Event event, int width) {
+            if (result.available[event]) {
+                os << std::setw(width) << result.per_operation[event];
+            } else {
+                os << std::setw(width) << "-";
+            }
+        };
+
+        os << std::left << std::setw(24) << result.operation << std::right << std::setw(10) << result.operations;
+        column(PerfCounters::cycles, 12);
+        column(PerfCounters::instructions, 12);
+        if (result.available[PerfCounters::instructions] && result.per_operation[PerfCounters::cycles] > 0.0) {
+            os << std::setw(8) << result.per_operation[PerfCounters::instructions] /
+                                      result.per_operation[PerfCounters::cycles];
+        } else {
+            os << std::setw(8) << "-";
+        }
+        column(PerfCounters::cache_misses, 14);
+        column(PerfCounters::branch_misses, 15);
+        os << std::setw(8) << (result.hardware ? "perf" : PerfCounters::fallback_source()) << "\n";
+    }
+    return os.str();
+}
+
+std::string TrackerBenchmark::format(const std::vector<ScalingResult> &results) {
+    std::ostringstream os;
+    os << std::left << std::setw(24) << "OPERATION" << std::setw(16) << "BACKEND" << std::right << std::setw(8)
+       << "THREADS" << std::setw(12) << "OPS" << std::setw(10) << "NS/OP" << std::setw(12) << "MOPS/S" << "\n";
+
+    os << std::fixed << std::setprecision(2);
+    for (const auto &result : results) {
+        os << std::left << std::setw(24) << result.operation << std::setw(16) << result.backend << std::right
+           << std::setw(8) << result.threads << std::setw(12) << result.operations << std::setw(10)
+           << result.nanoseconds_per_operation;
+        if (result.nanoseconds_per_operation > 0.0) {
+            os << std::setw(12) << 1000.0 / result.nanoseconds_per_operation;
+        } else {
+            os << std::setw(12) << "-";
+        }
+        os << "\n";
+    }
+    return os.str();
+}
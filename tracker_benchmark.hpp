@@ -0,0 +1,138 @@
+#ifndef TRACKER_BENCHMARK_HPP
+#define TRACKER_BENCHMARK_HPP
+
+#include <array>
+#include <cstddef>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "concurrent_interval_skip_list.hpp"
+#include "fixed_size_array_tracker.hpp"
+#include "interval_bplus_tree.hpp"
+#include "perf_counters.hpp"
+
+/**
+ * @class TrackerBenchmark
+ * @brief Measures the hot paths of FixedSizeArrayTracker per operation with hardware counters, see PerfCounters.
+ *
+ * Every measurement runs on a fragmented layout built the same way for a given seed: the array is filled with
+ * regions of random lengths and every other one is removed again. Inputs are generated before the counters start
+ * and each batch is run once on a copy of the tracker first, so the counted work is only the calls themselves with
+ * warm code and branch predictors. Logging is disabled on the trackers measured.
+ *
+ * Counters only count the calling thread, so measurements on several threads are timed by the wall clock instead
+ * and reported as ScalingResults.
+ *
+ * A command line tool only has to construct one and print format(run_all(n)) and format(run_scaling(n, threads)).
+ */
+class TrackerBenchmark {
+  public:
+    /**
+     * @brief The counts of one batch divided by the number of operations in it.
+     */
+    struct Result {
+        std::string operation;
+        std::size_t operations = 0;
+        std::array<double, PerfCounters::event_count> per_operation{};
+        std::array<bool, PerfCounters::event_count> available{};
+        /// false if cycles are fallback clock readings rather than core cycles, see PerfCounters::fallback_source.
+        bool hardware = false;
+    };
+
+    /**
+     * @brief The wall clock time of one batch on some number of threads divided by the operations of all of them.
+     */
+    struct ScalingResult {
+        std::string operation;
+        std::string backend;
+        unsigned int threads = 0;
+        std::size_t operations = 0;
+        double nanoseconds_per_operation = 0.0;
+    };
+
+    /**
+     * @param array_size The size of the tracked array.
+     * @param seed Seeds the layout and the inputs, equal seeds measure the same work.
+     * @param use_hardware False to measure with the fallback clock even where counters are available.
+     */
+    explicit TrackerBenchmark(unsigned int array_size = 1 << 20, unsigned int seed = 1, bool use_hardware = true);
+
+    /// find_contiguous_space with random lengths on the fragmented layout.
+    Result measure_find_contiguous_space(std::size_t operations);
+
+    /// add_metadata at the positions find_contiguous_space picks, fewer operations if some lengths don't fit.
+    Result measure_add_metadata(std::size_t operations);
+
+    /// remove_metadata of regions added as in measure_add_metadata, in random order.
+    Result measure_remove_metadata(std::size_t operations);
+
+    /**
+     * @brief Lookups, inserts and first fit searches on the region intervals of the fragmented layout, once in an
+     * IntervalBPlusTree and once in a std::set of (start, end) pairs, the red-black tree it replaced.
+     *
+     * The set's first fit walks the intervals in address order until a hole is long enough, the B+tree's is
+     * find_first_gap. First fit runs once with random lengths and once with a length longer than every hole of the
+     * layout, which makes the set walk all of it. Inserts place the regions measure_add_metadata would add.
+     */
+    std::vector<Result> measure_interval_indexes(std::size_t operations);
+
+    /**
+     * @brief allocate and remove on 1, 2, 4 and so on up to max_threads threads, once on a ConcurrentIntervalSkipList
+     * and once on a tracker behind a mutex, both starting from the fragmented layout.
+     *
+     * Every thread allocates random lengths first fit and removes its oldest region once it holds a few, each
+     * allocation and removal counts as an operation.
+     */
+    std::vector<ScalingResult> measure_thread_scaling(std::size_t operations_per_thread,
+                                                      unsigned int max_threads = 32);
+
+    /**
+     * @brief get_metadata on 1, 2, 4 and so on up to max_readers threads while one more thread keeps removing and
+     * re-adding regions, once lock free with get_metadata_concurrent and once with both sides behind a mutex.
+     *
+     * threads is the number of readers and only their lookups count as operations, the writer runs until the last
+     * reader is done.
+     */
+    std::vector<ScalingResult> measure_reader_scaling(std::size_t operations_per_thread,
+                                                      unsigned int max_readers = 32);
+
+    std::vector<Result> run_all(std::size_t operations);
+    std::vector<ScalingResult> run_scaling(std::size_t operations_per_thread, unsigned int max_threads = 32);
+
+    /// one row per result, unavailable counters show as "-".
+    static std::string format(const std::vector<Result> &results);
+    static std::string format(const std::vector<ScalingResult> &results);
+
+  private:
+    unsigned int array_size;
+    unsigned int seed;
+    PerfCounters counters;
+
+    /// the fragmented layout every measurement starts from.
+    FixedSizeArrayTracker make_fragmented_tracker() const;
+
+    /// placements for up to count new regions on tracker, found with find_contiguous_space on a copy of it.
+    std::vector<FixedSizeArrayTracker::Placement> plan_placements(const FixedSizeArrayTracker &tracker,
+                                                                  std::size_t count) const;
+
+    /// runs body on a copy of layout to warm up, then counts it on another copy.
+    template <typename Layout, typename Body>
+    Result measure(const std::string &operation, const Layout &layout, std::size_t operations, Body body);
+
+    /// starts work(thread) on threads threads at once, returns the nanoseconds until all of them returned.
+    template <typename Work> static double run_threads(unsigned int threads, Work &work);
+
+    /**
+     * @brief Runs make_work(state)(thread) on a copy of layout to warm up, then times it on another copy.
+     *
+     * make_work is called once per copy so it can set up fresh synchronization, every thread returns the
+     * operations it did.
+     */
+    template <typename State, typename MakeWork>
+    static ScalingResult measure_threads(const std::string &operation, const std::string &backend, const State &layout,
+                                         unsigned int threads, MakeWork make_work);
+};
+
+#endif // TRACKER_BENCHMARK_HPP
@@ -0,0 +1,22 @@
+#include "tracker_counters.hpp"
+
+TrackerCounters::TrackerCounters(const TrackerCounters &other) { *this = other; }
+
+TrackerCounters &TrackerCounters::operator=(const TrackerCounters &other) {
+    for (std::size_t i = 0; i < counter_count; ++i) {
+        values[i].store(other.values[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+    return *this;
+}
+
+void TrackerCounters::add(Counter counter, std::uint64_t amount) {
+    // there is a single writer, so nothing can slip in between the load and the store
+    std::atomic<std::uint64_t> &value = values[counter];
+    value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+void TrackerCounters::set(Counter counter, std::uint64_t value) {
+    values[counter].store(value, std::memory_order_relaxed);
+}
+
+std::uint64_t TrackerCounters::get(Counter counter) const { return values[counter].load(std::memory_order_relaxed); }
@@ -0,0 +1,53 @@
+#ifndef TRACKER_COUNTERS_HPP
+#define TRACKER_COUNTERS_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @class TrackerCounters
+ * @brief Counters a tracker keeps up to date as it changes, which any other thread may read at any time.
+ *
+ * Only the thread that owns the tracker writes them, so a write is a relaxed load and store rather than a locked
+ * read-modify-write and costs about as much as a plain increment. Readers get each counter on its own, not a
+ * consistent snapshot of all of them. Copying copies the current values.
+ */
+class TrackerCounters {
+  public:
+    enum Counter : std::size_t {
+        searches,
+        failed_searches,
+        additions,
+        failed_additions,
+        removals,
+        expirations,
+        compactions,
+        regions,
+        total_elements,
+        used_elements,
+        reserved_elements,
+        free_elements,
+        largest_free_block,
+        counter_count
+    };
+
+    TrackerCounters() = default;
+    TrackerCounters(const TrackerCounters &other);
+    TrackerCounters &operator=(const TrackerCounters &other);
+
+    /// writer thread only.
+    void add(Counter counter, std::uint64_t amount = 1);
+
+    /// writer thread only.
+    void set(Counter counter, std::uint64_t value);
+
+    /// safe from any thread.
+    std::uint64_t get(Counter counter) const;
+
+  private:
+    std::array<std::atomic<std::uint64_t>, counter_count> values{};
+};
+
+#endif // TRACKER_COUNTERS_HPP
@@ -0,0 +1,136 @@
+#include "tracker_registry.hpp"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+void add_memory(FixedSizeArrayTracker::MemoryFootprint &total, const FixedSizeArrayTracker::MemoryFootprint &memory) {
+    total.object_bytes += memory.object_bytes;
+    total.metadata_bytes += memory.metadata_bytes;
+    total.interval_index_bytes += memory.interval_index_bytes;
+    total.gap_index_bytes += memory.gap_index_bytes;
+    total.auxiliary_bytes += memory.auxiliary_bytes;
+    total.total_bytes += memory.total_bytes;
+}
+} // namespace
+
+TrackerRegistry &TrackerRegistry::instance() {
+    // never destroyed, trackers with static storage duration still unregister after exit has begun
+    static auto *registry = new TrackerRegistry;
+    return *registry;
+}
+
+void TrackerRegistry::add(const FixedSizeArrayTracker *tracker, const std::string &name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto entry = std::find_if(entries.begin(), entries.end(),
+                              [tracker](const Entry &candidate) { return candidate.tracker == tracker; });
+    if (entry != entries.end()) {
+        entry->name = name;
+        return;
+    }
+    entries.push_back({tracker, name});
+}
+
+void TrackerRegistry::remove(const FixedSizeArrayTracker *tracker) {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.erase(std::remove_if(entries.begin(), entries.end(),
+                                 [tracker](const Entry &entry) { return entry.tracker == tracker; }),
+                  entries.end());
+}
+
+std::size_t TrackerRegistry::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+FixedSizeArrayTracker::MemoryFootprint TrackerRegistry::get_total_memory_footprint() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    FixedSizeArrayTracker::MemoryFootprint total;
+    for (const auto &entry : entries) {
+        add_memory(total, entry.tracker->memory_footprint());
+    }
+    return total;
+}
+
+TrackerRegistry::TrackerStats TrackerRegistry::collect(const FixedSizeArrayTracker &tracker, const std::string &name,
+                                                       bool include_memory) {
+    const TrackerCounters &counters = tracker.get_counters();
+    TrackerStats stats;
+    stats.name = name;
+    stats.regions = counters.get(TrackerCounters::regions);
+    stats.total_elements = counters.get(TrackerCounters::total_elements);
+    stats.used_elements = counters.get(TrackerCounters::used_elements);
+    stats.reserved_elements = counters.get(TrackerCounters::reserved_elements);
+    stats.free_elements = counters.get(TrackerCounters::free_elements);
+    stats.largest_free_block = counters.get(TrackerCounters::largest_free_block);
+    if (stats.free_elements > 0) {
+        stats.fragmentation =
+            1.0 - static_cast<double>(stats.largest_free_block) / static_cast<double>(stats.free_elements);
+    }
+    stats.operations = tracker.get_operation_stats();
+    if (include_memory) {
+        stats.memory = tracker.memory_footprint();
+    }
+    return stats;
+}
+
+void TrackerRegistry::accumulate(TrackerStats &total, const TrackerStats &stats) {
+    total.regions += stats.regions;
+    total.total_elements += stats.total_elements;
+    total.used_elements += stats.used_elements;
+    total.reserved_elements += stats.reserved_elements;
+    total.free_elements += stats.free_elements;
+    total.largest_free_block += stats.largest_free_block;
+    total.operations.searches += stats.operations.searches;
+    total.operations.failed_searches += stats.operations.failed_searches;
+    total.operations.additions += stats.operations.additions;
+    total.operations.failed_additions += stats.operations.failed_additions;
+    total.operations.removals += stats.operations.removals;
+    total.operations.expirations += stats.operations.expirations;
+    total.operations.compactions += stats.operations.compactions;
+    add_memory(total.memory, stats.memory);
+}
+
+TrackerRegistry::AggregateStats TrackerRegistry::get_stats(bool include_memory) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    AggregateStats stats;
+    stats.total.name = "total";
+    stats.trackers.reserve(entries.size());
+    for (const auto &entry : entries) {
+        stats.trackers.push_back(collect(*entry.tracker, entry.name, include_memory));
+        accumulate(stats.total, stats.trackers.back());
+    }
+
+    // the free space weighted mean of the per tracker fragmentation
+    if (stats.total.free_elements > 0) {
+        stats.total.fragmentation =
+            1.0 - static_cast<double>(stats.total.largest_free_block) / static_cast<double>(stats.total.free_elements);
+    }
+    return stats;
+}
+
+std::string TrackerRegistry::dump(bool include_memory) const {
+    AggregateStats stats = get_stats(include_memory);
+    std::ostringstream os;
+    os << std::fixed << std::setprecision(4);
+
+    auto write = [&os](const TrackerStats &tracker) {
+        double usage = tracker.total_elements == 0
+                           ? 0.0
+                           : static_cast<double>(tracker.used_elements) / static_cast<double>(tracker.total_elements);
+        os << tracker.name << " regions=" << tracker.regions << " size=" << tracker.total_elements
+           << " used=" << tracker.used_elements << " reserved=" << tracker.reserved_elements
+           << " usage=" << usage << " free=" << tracker.free_elements
+           << " largest_free=" << tracker.largest_free_block << " fragmentation=" << tracker.fragmentation
+           << " searches=" << tracker.operations.searches << " failed_searches=" << tracker.operations.failed_searches
+           << " additions=" << tracker.operations.additions
+           << " failed_additions=" << tracker.operations.failed_additions
+           << " removals=" << tracker.operations.removals << " expirations=" << tracker.operations.expirations
+           << " compactions=" << tracker.operations.compactions << " memory=" << tracker.memory.total_bytes << "\n";
+    };
+    for (const auto &tracker : stats.trackers) {
+        write(tracker);
+    }
+    write(stats.total);
+    return os.str();
+}
@@ -0,0 +1,95 @@
+#ifndef TRACKER_REGISTRY_HPP
+#define TRACKER_REGISTRY_HPP
+
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "fixed_size_array_tracker.hpp"
+
+/**
+ * @class TrackerRegistry
+ * @brief The named trackers of a process, with totals and a stats dump over all of them.
+ *
+ * Registering is optional. Trackers are added explicitly and leave on their own when destroyed. Copies and moves of
+ * a registered tracker aren't registered. Every figure comes from counters the trackers keep up to date as they
+ * change, so collecting the stats of a tracker costs the same whatever the number of its regions.
+ *
+ * The registry is thread safe. Stats without memory figures only read the trackers' atomic counters and can be
+ * collected from any thread while the trackers are in use, see StatsServer. Memory figures and
+ * get_total_memory_footprint read the trackers' containers, so they must not run while another thread mutates one.
+ */
+class TrackerRegistry {
+  public:
+    /**
+     * @brief The stats of one tracker, or the sums over all of them.
+     */
+    struct TrackerStats {
+        std::string name;
+        std::size_t regions = 0;
+        /// as in FixedSizeArrayTracker::UsageStats, wide enough to sum over any number of trackers.
+        unsigned long long total_elements = 0;
+        unsigned long long used_elements = 0;
+        unsigned long long reserved_elements = 0;
+        /// elements that can still be allocated, parked quick list ranges included.
+        unsigned long long free_elements = 0;
+        /// the largest single free block, for the total the sum of those of every tracker.
+        unsigned long long largest_free_block = 0;
+        /// 1 - largest_free_block / free_elements, so the total weighs each tracker by its free space.
+        double fragmentation = 0.0;
+        FixedSizeArrayTracker::OperationStats operations;
+        /// all zero unless memory figures were asked for.
+        FixedSizeArrayTracker::MemoryFootprint memory;
+    };
+
+    /**
+     * @brief A snapshot of every registered tracker, in registration order, and their total.
+     */
+    struct AggregateStats {
+        std::vector<TrackerStats> trackers;
+        TrackerStats total;
+    };
+
+    /// the registry of this process, it lives until the process ends so destructors can always reach it.
+    static TrackerRegistry &instance();
+
+    /// adds a tracker, or renames it if it is registered already. Names don't have to be unique.
+    void add(const FixedSizeArrayTracker *tracker, const std::string &name);
+    void remove(const FixedSizeArrayTracker *tracker);
+
+    std::size_t size() const;
+
+    /**
+     * @brief The memory_footprint of every registered tracker summed up field by field.
+     */
+    FixedSizeArrayTracker::MemoryFootprint get_total_memory_footprint() const;
+
+    AggregateStats get_stats(bool include_memory = true) const;
+
+    /**
+     * @brief Formats get_stats as one line of key=value pairs per tracker followed by a line for the total.
+     *
+     * Every line starts with the tracker name, the total is named "total", and the keys and their order are fixed,
+     * so dumps taken periodically can be diffed or parsed line by line.
+     */
+    std::string dump(bool include_memory = true) const;
+
+  private:
+    TrackerRegistry() = default;
+
+    struct Entry {
+        const FixedSizeArrayTracker *tracker;
+        std::string name;
+    };
+
+    mutable std::mutex mutex;
+    std::vector<Entry> entries;
+
+    static TrackerStats collect(const FixedSizeArrayTracker &tracker, const std::string &name, bool include_memory);
+
+    /// adds the counters of stats into total, fragmentation is derived once everything is in.
+    static void accumulate(TrackerStats &total, const TrackerStats &stats);
+};
+
+#endif // TRACKER_REGISTRY_HPP